@@ -0,0 +1,99 @@
+#ifndef CPP_TREE_SITTER_ANCESTRY_H
+#define CPP_TREE_SITTER_ANCESTRY_H
+
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/flat_tree.hpp"
+
+// Constant-time ancestry queries over a flat_tree. Ancestor tests use the
+// preorder interval of each subtree; lowest common ancestors use a sparse
+// table of range-minimum depths over preorder positions: for u < v, the
+// shallowest node in (u, v] is a child of LCA(u, v). This needs n entries per
+// level where an Euler tour would need 2n - 1.
+
+namespace ts
+{
+
+    class ancestry_index
+    {
+    public:
+        ancestry_index() = default;
+
+        // `tree` must outlive the index and not be reassigned while in use.
+        explicit ancestry_index(const flat_tree &tree)
+        {
+            assign(tree);
+        }
+
+        auto assign(const flat_tree &tree) -> void
+        {
+            this->tree = &tree;
+            size = tree.size();
+            table.clear();
+            if (size == 0)
+            {
+                return;
+            }
+
+            auto num_levels = static_cast<uint32_t>(std::bit_width(size));
+            table.resize(static_cast<size_t>(num_levels) * size);
+            for (node_position position = 0; position < size; ++position)
+            {
+                table[position] = position;
+            }
+            for (uint32_t level = 1; level < num_levels; ++level)
+            {
+                const node_position *previous = &table[static_cast<size_t>(level - 1) * size];
+                node_position *current = &table[static_cast<size_t>(level) * size];
+                node_position half = node_position{1} << (level - 1);
+                for (node_position position = 0; position + 2 * half <= size; ++position)
+                {
+                    current[position] = shallower(previous[position], previous[position + half]);
+                }
+            }
+        }
+
+        [[nodiscard]] auto is_ancestor(node_position ancestor, node_position descendant) const -> bool
+        {
+            return tree->is_ancestor(ancestor, descendant);
+        }
+
+        [[nodiscard]] auto get_lowest_common_ancestor(node_position a, node_position b) const -> node_position
+        {
+            if (a == b)
+            {
+                return a;
+            }
+            node_position first = std::min(a, b) + 1;
+            node_position last = std::max(a, b) + 1;
+            auto level = static_cast<uint32_t>(std::bit_width(last - first)) - 1;
+            const node_position *row = &table[static_cast<size_t>(level) * size];
+            node_position shallowest = shallower(row[first], row[last - (node_position{1} << level)]);
+            return tree->get_parent(shallowest);
+        }
+
+        // Number of edges on the path between `a` and `b`.
+        [[nodiscard]] auto get_distance(node_position a, node_position b) const -> uint32_t
+        {
+            uint32_t common = tree->get_depth(get_lowest_common_ancestor(a, b));
+            return tree->get_depth(a) + tree->get_depth(b) - 2 * common;
+        }
+
+    private:
+        [[nodiscard]] auto shallower(node_position a, node_position b) const -> node_position
+        {
+            return tree->get_depth(b) < tree->get_depth(a) ? b : a;
+        }
+
+        const flat_tree *tree = nullptr;
+        node_position size = 0;
+        // Level k holds, for each i, the shallowest position in [i, i + 2^k).
+        std::vector<node_position> table;
+    };
+
+}
+
+#endif
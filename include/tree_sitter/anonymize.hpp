@@ -0,0 +1,236 @@
+#ifndef CPP_TREE_SITTER_ANONYMIZE_H
+#define CPP_TREE_SITTER_ANONYMIZE_H
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "tree_sitter/batch.hpp"
+#include "tree_sitter/bundled.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/scopes.hpp"
+
+// Consistent identifier renaming for anonymized datasets. Every identifier
+// leaf (any named node type ending in `identifier`) is replaced by a canonical
+// name numbered in order of first appearance: `f` for function names and
+// callees, `t` for types and `v` for everything else, as in `v0`, `f1`, `t2`.
+// Everything else is copied through, so the result needs no reparse.
+//
+// By default a name is renamed the same way throughout the file. Given the
+// scope_map of the file, definitions found by the locals query (and the
+// references resolved to them) are renamed per definition instead, so that
+// unrelated locals sharing a name get distinct names. Uses the locals query
+// leaves unresolved, such as calls to functions it does not record, share the
+// name of the definition with the same text when there is exactly one, and
+// are renamed by text otherwise. A name's prefix considers all its uses: `f`
+// if any is a function name or callee, else `t` if any is a type.
+
+namespace ts
+{
+
+    class identifier_anonymizer
+    {
+    public:
+        explicit identifier_anonymizer(language language)
+            : kinds(language.get_num_symbols(), kind::none),
+              function_parents(language.get_num_symbols(), false)
+        {
+            for (symbol id = 0; id < kinds.size(); ++id)
+            {
+                std::string_view name = language.get_symbol_name(id);
+                if (language.get_symbol_type(id) == TSSymbolTypeRegular && name.ends_with("identifier"))
+                {
+                    kinds[id] = name.find("type") != std::string_view::npos ? kind::type : kind::variable;
+                }
+                if (name.find("call") != std::string_view::npos || name.find("function") != std::string_view::npos ||
+                    name.find("method") != std::string_view::npos)
+                {
+                    function_parents[id] = true;
+                }
+            }
+        }
+
+        // Appends the rewritten `source` to `out`. `locals`, if given, must
+        // have been built from the same tree.
+        auto rewrite(const tree &tree,
+                     std::string_view source,
+                     std::string &out,
+                     const scope_map *locals = nullptr) const -> void
+        {
+            struct occurrence
+            {
+                extent<uint32_t> bytes;
+                uint32_t name;
+            };
+            std::vector<occurrence> occurrences;
+            // Per canonical name, in order of first appearance.
+            std::vector<kind> name_kinds;
+            std::unordered_map<std::string_view, uint32_t> by_text;
+            std::vector<uint32_t> by_definition(locals ? locals->definitions.size() : 0, no_local);
+
+            // Unresolved uses of a text take the name of its definition when
+            // the locals query found exactly one.
+            constexpr uint32_t ambiguous = no_local - 1;
+            std::unordered_map<std::string_view, uint32_t> definition_by_text;
+            if (locals)
+            {
+                for (uint32_t definition = 0; definition < locals->definitions.size(); ++definition)
+                {
+                    extent<uint32_t> bytes = locals->definitions[definition].bytes;
+                    auto [it, inserted] =
+                        definition_by_text.try_emplace(source.substr(bytes.start, bytes.end - bytes.start), definition);
+                    if (!inserted)
+                    {
+                        it->second = ambiguous;
+                    }
+                }
+            }
+
+            visit(tree.get_root_node(),
+                  [&](const node_path &path)
+                  {
+                      node node = path.get_node();
+                      symbol id = node.get_symbol();
+                      if (id >= kinds.size() || kinds[id] == kind::none || node.get_num_children() > 0)
+                      {
+                          return;
+                      }
+
+                      extent<uint32_t> bytes = node.get_byte_range();
+                      std::string_view text = node.get_source_range(source);
+                      uint32_t *slot = nullptr;
+                      if (locals)
+                      {
+                          uint32_t definition = find_definition(*locals, bytes);
+                          if (definition == no_local)
+                          {
+                              auto found = definition_by_text.find(text);
+                              definition = found != definition_by_text.end() && found->second != ambiguous
+                                               ? found->second
+                                               : no_local;
+                          }
+                          if (definition != no_local)
+                          {
+                              slot = &by_definition[definition];
+                          }
+                      }
+                      if (!slot)
+                      {
+                          slot = &by_text.try_emplace(text, no_local).first->second;
+                      }
+                      if (*slot == no_local)
+                      {
+                          *slot = static_cast<uint32_t>(name_kinds.size());
+                          name_kinds.push_back(kind::none);
+                      }
+                      name_kinds[*slot] = std::max(name_kinds[*slot], get_use(path, kinds[id]));
+                      occurrences.push_back({bytes, *slot});
+                  });
+
+            uint32_t last_end = 0;
+            for (const occurrence &occurrence : occurrences)
+            {
+                kind name_kind = name_kinds[occurrence.name];
+                out.append(source.substr(last_end, occurrence.bytes.start - last_end));
+                out.push_back(name_kind == kind::function ? 'f' : name_kind == kind::type ? 't' : 'v');
+                out.append(std::to_string(occurrence.name));
+                last_end = occurrence.bytes.end;
+            }
+            out.append(source.substr(last_end));
+        }
+
+        [[nodiscard]] auto rewrite(const tree &tree, std::string_view source, const scope_map *locals = nullptr) const
+            -> std::string
+        {
+            std::string out;
+            out.reserve(source.size());
+            rewrite(tree, source, out, locals);
+            return out;
+        }
+
+    private:
+        // In increasing precedence for choosing a name's prefix.
+        enum class kind : uint8_t
+        {
+            none,
+            variable,
+            type,
+            function,
+        };
+
+        // How the identifier at the end of `path` is used.
+        [[nodiscard]] auto get_use(const node_path &path, kind category) const -> kind
+        {
+            if (category == kind::type)
+            {
+                return kind::type;
+            }
+            node parent = path.get_parent();
+            if (!parent.is_null() && parent.get_symbol() < function_parents.size() &&
+                function_parents[parent.get_symbol()])
+            {
+                return kind::function;
+            }
+            return kind::variable;
+        }
+
+        // The definition `bytes` names or refers to, or no_local.
+        [[nodiscard]] static auto find_definition(const scope_map &locals, extent<uint32_t> bytes) -> uint32_t
+        {
+            uint32_t definition = locals.find_definition(bytes.start);
+            if (definition != no_local && locals.definitions[definition].bytes.end == bytes.end)
+            {
+                return definition;
+            }
+            uint32_t reference = locals.find_reference(bytes.start);
+            if (reference != no_local && locals.references[reference].bytes.end == bytes.end)
+            {
+                return locals.references[reference].definition;
+            }
+            return no_local;
+        }
+
+        std::vector<kind> kinds;
+        // Whether identifier children of a symbol are function names or
+        // callees.
+        std::vector<bool> function_parents;
+    };
+
+    // Anonymizes every file in parallel with per-file naming; the result for
+    // files[i] is element i.
+    [[nodiscard]] inline auto anonymize_sources(std::span<const source_file> files, unsigned threads = 0)
+        -> std::vector<std::string>
+    {
+        std::array<std::unique_ptr<identifier_anonymizer>, std::size(bundled_languages)> anonymizers;
+        for (const source_file &file : files)
+        {
+            auto &slot = anonymizers[static_cast<size_t>(file.language)];
+            if (!slot)
+            {
+                slot = std::make_unique<identifier_anonymizer>(get_language(file.language));
+            }
+        }
+
+        std::vector<std::string> results(files.size());
+        unsigned num_workers = get_worker_count(files.size(), threads);
+        parser_pool parsers{num_workers};
+        parallel_for(
+            files.size(),
+            [&](size_t index, unsigned worker)
+            {
+                const source_file &file = files[index];
+                tree tree = parsers.get(worker, get_language(file.language)).parse_string(file.text);
+                results[index] = anonymizers[static_cast<size_t>(file.language)]->rewrite(tree, file.text);
+            },
+            num_workers);
+        return results;
+    }
+
+}
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef CPP_TREE_SITTER_BATCH_H
+#define CPP_TREE_SITTER_BATCH_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "tree_sitter/cpp-tree-sitter.hpp"
+
+// Helpers for spreading per-file work across cores. Parsers and query cursors
+// are not thread-safe, so every worker owns its own; languages and compiled
+// queries are immutable and may be shared freely.
+
+namespace ts
+{
+
+    // Clamps a requested thread count (0 meaning "one per core") to the amount
+    // of work available.
+    [[nodiscard]] inline auto get_worker_count(size_t count, unsigned threads = 0) -> unsigned
+    {
+        if (threads == 0)
+        {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        return static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, count)));
+    }
+
+    // Calls fn(index, worker) for every index in [0, count). Indices are handed
+    // out dynamically so uneven file sizes still balance. `worker` is in
+    // [0, get_worker_count(count, threads)) and can index per-worker state. The
+    // first exception thrown by any worker is rethrown once all have stopped.
+    template <typename Fn>
+    auto parallel_for(size_t count, Fn &&fn, unsigned threads = 0) -> void
+    {
+        unsigned num_workers = get_worker_count(count, threads);
+        std::atomic<size_t> next{0};
+        std::exception_ptr failure;
+        std::mutex failure_lock;
+
+        auto work = [&](unsigned worker)
+        {
+            try
+            {
+                for (size_t index; (index = next.fetch_add(1, std::memory_order_relaxed)) < count;)
+                {
+                    fn(index, worker);
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard lock{failure_lock};
+                if (!failure)
+                {
+                    failure = std::current_exception();
+                }
+                next.store(count, std::memory_order_relaxed);
+            }
+        };
+
+        {
+            std::vector<std::jthread> pool;
+            pool.reserve(num_workers - 1);
+            for (unsigned worker = 1; worker < num_workers; ++worker)
+            {
+                pool.emplace_back(work, worker);
+            }
+            work(0);
+        }
+
+        if (failure)
+        {
+            std::rethrow_exception(failure);
+        }
+    }
+
+    // One lazily created parser per worker, switched to whichever language the
+    // current file needs.
+    class parser_pool
+    {
+    public:
+        explicit parser_pool(unsigned num_workers)
+            : parsers(num_workers)
+        {
+        }
+
+        [[nodiscard]] auto get_num_workers() const -> unsigned
+        {
+            return static_cast<unsigned>(parsers.size());
+        }
+
+        [[nodiscard]] auto get(unsigned worker, language language) -> parser &
+        {
+            std::optional<parser> &slot = parsers[worker];
+            if (!slot)
+            {
+                slot.emplace(language);
+            }
+            else if (slot->get_language().impl != language.impl)
+            {
+                slot->set_language(language);
+            }
+            return *slot;
+        }
+
+    private:
+        std::vector<std::optional<parser>> parsers;
+    };
+
+    // Parses every source with `language` in parallel and calls
+    // fn(tree, source, index, worker) for each. Trees are destroyed once fn
+    // returns.
+    template <typename Fn>
+    auto parse_each(language language, std::span<const std::string_view> sources, Fn &&fn, unsigned threads = 0) -> void
+    {
+        parser_pool pool{get_worker_count(sources.size(), threads)};
+        parallel_for(
+            sources.size(),
+            [&](size_t index, unsigned worker)
+            {
+                tree tree = pool.get(worker, language).parse_string(sources[index]);
+                fn(static_cast<const ts::tree &>(tree), sources[index], index, worker);
+            },
+            pool.get_num_workers());
+    }
+
+}
+
+#endif
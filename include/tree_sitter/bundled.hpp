@@ -0,0 +1,186 @@
+#ifndef CPP_TREE_SITTER_BUNDLED_H
+#define CPP_TREE_SITTER_BUNDLED_H
+
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "tree_sitter/cpp-tree-sitter.hpp"
+
+// The grammars built alongside the runtime, for code that needs per-language
+// tables. Using these requires linking the matching Tree-Sitter-<lang> targets.
+
+namespace ts
+{
+
+    enum class bundled_language : uint8_t
+    {
+        c,
+        cpp,
+        c_sharp,
+        go,
+        java,
+        javascript,
+        json,
+        python,
+        rust,
+        typescript,
+        tsx,
+    };
+
+    inline constexpr bundled_language bundled_languages[] = {
+        bundled_language::c,
+        bundled_language::cpp,
+        bundled_language::c_sharp,
+        bundled_language::go,
+        bundled_language::java,
+        bundled_language::javascript,
+        bundled_language::json,
+        bundled_language::python,
+        bundled_language::rust,
+        bundled_language::typescript,
+        bundled_language::tsx,
+    };
+
+    [[nodiscard]] inline auto get_language(bundled_language language) -> ts::language
+    {
+        switch (language)
+        {
+        case bundled_language::c:
+            return tree_sitter_c();
+        case bundled_language::cpp:
+            return tree_sitter_cpp();
+        case bundled_language::c_sharp:
+            return tree_sitter_c_sharp();
+        case bundled_language::go:
+            return tree_sitter_go();
+        case bundled_language::java:
+            return tree_sitter_java();
+        case bundled_language::javascript:
+            return tree_sitter_javascript();
+        case bundled_language::json:
+            return tree_sitter_json();
+        case bundled_language::python:
+            return tree_sitter_python();
+        case bundled_language::rust:
+            return tree_sitter_rust();
+        case bundled_language::typescript:
+            return tree_sitter_typescript();
+        case bundled_language::tsx:
+            return tree_sitter_tsx();
+        }
+        return tree_sitter_c();
+    }
+
+    [[nodiscard]] inline auto get_name(bundled_language language) -> std::string_view
+    {
+        switch (language)
+        {
+        case bundled_language::c:
+            return "c";
+        case bundled_language::cpp:
+            return "cpp";
+        case bundled_language::c_sharp:
+            return "c_sharp";
+        case bundled_language::go:
+            return "go";
+        case bundled_language::java:
+            return "java";
+        case bundled_language::javascript:
+            return "javascript";
+        case bundled_language::json:
+            return "json";
+        case bundled_language::python:
+            return "python";
+        case bundled_language::rust:
+            return "rust";
+        case bundled_language::typescript:
+            return "typescript";
+        case bundled_language::tsx:
+            return "tsx";
+        }
+        return {};
+    }
+
+    // A file to be processed by one of the multi-language drivers.
+    struct source_file
+    {
+        std::string_view path;
+        std::string_view text;
+        bundled_language language;
+    };
+
+    // Guesses the grammar for a file from its extension. Headers (`.h`) are
+    // given to the C++ grammar, which also accepts C.
+    [[nodiscard]] inline auto detect_language(std::string_view path) -> std::optional<bundled_language>
+    {
+        size_t dot = path.find_last_of('.');
+        size_t slash = path.find_last_of("/\\");
+        if (dot == std::string_view::npos || (slash != std::string_view::npos && dot < slash))
+        {
+            return std::nullopt;
+        }
+
+        static constexpr std::pair<std::string_view, bundled_language> extensions[] = {
+            {".c", bundled_language::c},
+            {".h", bundled_language::cpp},
+            {".cc", bundled_language::cpp},
+            {".cpp", bundled_language::cpp},
+            {".cxx", bundled_language::cpp},
+            {".hh", bundled_language::cpp},
+            {".hpp", bundled_language::cpp},
+            {".hxx", bundled_language::cpp},
+            {".ipp", bundled_language::cpp},
+            {".cs", bundled_language::c_sharp},
+            {".go", bundled_language::go},
+            {".java", bundled_language::java},
+            {".js", bundled_language::javascript},
+            {".jsx", bundled_language::javascript},
+            {".mjs", bundled_language::javascript},
+            {".cjs", bundled_language::javascript},
+            {".json", bundled_language::json},
+            {".jsonl", bundled_language::json},
+            {".ndjson", bundled_language::json},
+            {".py", bundled_language::python},
+            {".pyi", bundled_language::python},
+            {".rs", bundled_language::rust},
+            {".ts", bundled_language::typescript},
+            {".mts", bundled_language::typescript},
+            {".cts", bundled_language::typescript},
+            {".tsx", bundled_language::tsx},
+        };
+        std::string_view extension = path.substr(dot);
+        for (const auto &[candidate, language] : extensions)
+        {
+            if (extension == candidate)
+            {
+                return language;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Symbol classes that several tools treat specially, decided from the
+    // symbol names the bundled grammars use so that the tools agree.
+
+    [[nodiscard]] inline auto is_comment_symbol(language language, symbol id) -> bool
+    {
+        return language.get_symbol_type(id) == TSSymbolTypeRegular &&
+               language.get_symbol_name(id).find("comment") != std::string_view::npos;
+    }
+
+    // String literals and their parts, and character and rune literals.
+    [[nodiscard]] inline auto is_literal_symbol(language language, symbol id) -> bool
+    {
+        if (language.get_symbol_type(id) != TSSymbolTypeRegular || is_comment_symbol(language, id))
+        {
+            return false;
+        }
+        std::string_view name = language.get_symbol_name(id);
+        return name.find("string") != std::string_view::npos || name.ends_with("char_literal") ||
+               name.ends_with("character_literal") || name.ends_with("rune_literal");
+    }
+
+}
+
+#endif
@@ -0,0 +1,341 @@
+#ifndef CPP_TREE_SITTER_CALL_GRAPH_H
+#define CPP_TREE_SITTER_CALL_GRAPH_H
+
+#include <array>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "tree_sitter/batch.hpp"
+#include "tree_sitter/bundled.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/text_predicates.hpp"
+
+// Name-based call graphs. Each file is queried once for function definitions
+// (@definition with its @name) and call sites (@callee); names are then linked
+// across files in parallel through a sharded hash map.
+
+namespace ts
+{
+
+    inline constexpr uint32_t no_function = std::numeric_limits<uint32_t>::max();
+
+    struct function_record
+    {
+        std::string name;
+        extent<uint32_t> bytes;
+        extent<uint32_t> name_bytes;
+    };
+
+    struct call_record
+    {
+        // Index of the enclosing function in the same file, or no_function for
+        // calls at file scope.
+        uint32_t caller;
+        std::string callee;
+        extent<uint32_t> bytes;
+    };
+
+    struct call_sites
+    {
+        std::vector<function_record> functions;
+        std::vector<call_record> calls;
+    };
+
+    // Reduces a qualified or member name (`a::b<T>`, `obj.f`, `p->g`) to the
+    // final identifier, which is what calls are linked by.
+    [[nodiscard]] inline auto get_short_name(std::string_view name) -> std::string_view
+    {
+        // Drop trailing template arguments, which may themselves nest.
+        if (!name.empty() && name.back() == '>')
+        {
+            int depth = 0;
+            for (size_t i = name.size(); i-- > 0;)
+            {
+                depth += name[i] == '>' ? 1 : name[i] == '<' ? -1 : 0;
+                if (depth == 0)
+                {
+                    name = name.substr(0, i);
+                    break;
+                }
+            }
+        }
+        size_t start = name.find_last_of(".:>");
+        if (start != std::string_view::npos)
+        {
+            name.remove_prefix(start + 1);
+        }
+        while (!name.empty() && (name.front() == ' ' || name.front() == '~'))
+        {
+            name.remove_prefix(1);
+        }
+        return name;
+    }
+
+    [[nodiscard]] inline auto get_call_query(bundled_language language) -> std::string_view
+    {
+        switch (language)
+        {
+        case bundled_language::c:
+            return R"((function_definition) @definition
+(function_declarator declarator: (identifier) @name)
+(call_expression function: (_) @callee))";
+        case bundled_language::cpp:
+            return R"((function_definition) @definition
+(function_declarator declarator: (_) @name)
+(call_expression function: (_) @callee)
+(new_expression type: (_) @callee))";
+        case bundled_language::c_sharp:
+            return R"((method_declaration name: (identifier) @name) @definition
+(constructor_declaration name: (identifier) @name) @definition
+(invocation_expression function: (_) @callee))";
+        case bundled_language::go:
+            return R"((function_declaration name: (identifier) @name) @definition
+(method_declaration name: (field_identifier) @name) @definition
+(call_expression function: (_) @callee))";
+        case bundled_language::java:
+            return R"((method_declaration name: (identifier) @name) @definition
+(constructor_declaration name: (identifier) @name) @definition
+(method_invocation name: (identifier) @callee)
+(object_creation_expression type: (_) @callee))";
+        case bundled_language::javascript:
+        case bundled_language::typescript:
+        case bundled_language::tsx:
+            return R"((function_declaration name: (identifier) @name) @definition
+(method_definition name: (property_identifier) @name) @definition
+(variable_declarator name: (identifier) @name value: [(arrow_function) (function)]) @definition
+(call_expression function: (_) @callee)
+(new_expression constructor: (_) @callee))";
+        case bundled_language::python:
+            return R"((function_definition name: (identifier) @name) @definition
+(call function: (_) @callee))";
+        case bundled_language::json:
+            return {};
+        case bundled_language::rust:
+            return R"((function_item name: (identifier) @name) @definition
+(call_expression function: (_) @callee))";
+        }
+        return {};
+    }
+
+    class call_extractor
+    {
+    public:
+        // Throws query_error if the bundled query does not match the grammar.
+        explicit call_extractor(bundled_language language)
+            : calls{get_language(language), get_call_query(language)},
+              call_predicates{calls},
+              definition_id{calls.get_capture_id("definition").value_or(no_function)},
+              name_id{calls.get_capture_id("name").value_or(no_function)},
+              callee_id{calls.get_capture_id("callee").value_or(no_function)}
+        {
+        }
+
+        // Definitions are matched to the innermost open @definition that has
+        // no name yet, so a name may come from a separate pattern (as with C
+        // declarators); calls are attributed to the innermost open definition.
+        auto extract(const tree &tree, std::string_view source, query_cursor &cursor, call_sites &sites) const -> void
+        {
+            std::vector<uint32_t> open;
+            cursor.exec(calls, tree.get_root_node());
+            query_match match;
+            uint32_t position = 0;
+            while (cursor.next_capture(match, position))
+            {
+                uint32_t id = match.get_capture_id(position);
+                node node = match.get_capture_node(position);
+                extent<uint32_t> bytes = node.get_byte_range();
+                while (!open.empty() && bytes.start >= sites.functions[open.back()].bytes.end)
+                {
+                    open.pop_back();
+                }
+
+                if (id == definition_id)
+                {
+                    sites.functions.push_back({{}, bytes, {bytes.start, bytes.start}});
+                    open.push_back(static_cast<uint32_t>(sites.functions.size() - 1));
+                }
+                else if (id == name_id)
+                {
+                    if (!open.empty() && sites.functions[open.back()].name.empty())
+                    {
+                        sites.functions[open.back()].name = node.get_source_range(source);
+                        sites.functions[open.back()].name_bytes = bytes;
+                    }
+                }
+                else if (id == callee_id && call_predicates.satisfies(match, source))
+                {
+                    sites.calls.push_back(
+                        {open.empty() ? no_function : open.back(), std::string{node.get_source_range(source)}, bytes});
+                }
+            }
+        }
+
+        [[nodiscard]] auto extract(const tree &tree, std::string_view source) const -> call_sites
+        {
+            call_sites sites;
+            query_cursor cursor;
+            extract(tree, source, cursor, sites);
+            return sites;
+        }
+
+    private:
+        query calls;
+        text_predicates call_predicates;
+        uint32_t definition_id;
+        uint32_t name_id;
+        uint32_t callee_id;
+    };
+
+    struct function_ref
+    {
+        uint32_t file;
+        uint32_t function;
+    };
+
+    struct call_edge
+    {
+        // The call is call_graph::files[file].calls[call].
+        uint32_t file;
+        uint32_t call;
+        function_ref callee;
+    };
+
+    struct call_graph
+    {
+        std::vector<call_sites> files;
+        std::vector<call_edge> edges;
+    };
+
+    // A hash multimap split into independently locked shards, so concurrent
+    // inserts from many workers rarely contend. Lookups take no lock and must
+    // only start once all inserts are done.
+    template <typename Value, size_t NumShards = 64>
+    class sharded_multimap
+    {
+    public:
+        auto insert(std::string_view key, Value value) -> void
+        {
+            shard &target = shards[std::hash<std::string_view>{}(key) % NumShards];
+            std::lock_guard lock{target.lock};
+            auto it = target.entries.find(key);
+            if (it == target.entries.end())
+            {
+                it = target.entries.emplace(std::string{key}, std::vector<Value>{}).first;
+            }
+            it->second.push_back(value);
+        }
+
+        [[nodiscard]] auto find(std::string_view key) const -> std::span<const Value>
+        {
+            const shard &target = shards[std::hash<std::string_view>{}(key) % NumShards];
+            auto it = target.entries.find(key);
+            if (it == target.entries.end())
+            {
+                return {};
+            }
+            return it->second;
+        }
+
+    private:
+        struct key_hash
+        {
+            using is_transparent = void;
+
+            auto operator()(std::string_view key) const -> size_t
+            {
+                return std::hash<std::string_view>{}(key);
+            }
+        };
+
+        struct shard
+        {
+            std::mutex lock;
+            std::unordered_map<std::string, std::vector<Value>, key_hash, std::equal_to<>> entries;
+        };
+
+        std::array<shard, NumShards> shards;
+    };
+
+    // Extracts every file and links each call to the functions of the same
+    // short name. A definition in the calling file wins over others; otherwise
+    // every candidate across the repository gets an edge.
+    [[nodiscard]] inline auto build_call_graph(std::span<const source_file> files, unsigned threads = 0) -> call_graph
+    {
+        std::array<std::unique_ptr<call_extractor>, std::size(bundled_languages)> extractors;
+        for (const source_file &file : files)
+        {
+            auto &slot = extractors[static_cast<size_t>(file.language)];
+            if (!slot)
+            {
+                slot = std::make_unique<call_extractor>(file.language);
+            }
+        }
+
+        call_graph graph;
+        graph.files.resize(files.size());
+        auto definitions = std::make_unique<sharded_multimap<function_ref>>();
+
+        unsigned num_workers = get_worker_count(files.size(), threads);
+        parser_pool parsers{num_workers};
+        std::vector<query_cursor> cursors(num_workers);
+        parallel_for(
+            files.size(),
+            [&](size_t index, unsigned worker)
+            {
+                const source_file &file = files[index];
+                tree tree = parsers.get(worker, get_language(file.language)).parse_string(file.text);
+                call_sites &sites = graph.files[index];
+                extractors[static_cast<size_t>(file.language)]->extract(tree, file.text, cursors[worker], sites);
+                for (uint32_t function = 0; function < sites.functions.size(); ++function)
+                {
+                    std::string_view name = get_short_name(sites.functions[function].name);
+                    if (!name.empty())
+                    {
+                        definitions->insert(name, {static_cast<uint32_t>(index), function});
+                    }
+                }
+            },
+            num_workers);
+
+        std::vector<std::vector<call_edge>> linked(files.size());
+        parallel_for(
+            files.size(),
+            [&](size_t index, unsigned)
+            {
+                const call_sites &sites = graph.files[index];
+                for (uint32_t call = 0; call < sites.calls.size(); ++call)
+                {
+                    std::span<const function_ref> candidates = definitions->find(get_short_name(sites.calls[call].callee));
+                    bool local = false;
+                    for (const function_ref &candidate : candidates)
+                    {
+                        local = local || candidate.file == index;
+                    }
+                    for (const function_ref &candidate : candidates)
+                    {
+                        if (!local || candidate.file == index)
+                        {
+                            linked[index].push_back({static_cast<uint32_t>(index), call, candidate});
+                        }
+                    }
+                }
+            },
+            num_workers);
+
+        for (std::vector<call_edge> &edges : linked)
+        {
+            graph.edges.insert(graph.edges.end(), edges.begin(), edges.end());
+        }
+        return graph;
+    }
+
+}
+
+#endif
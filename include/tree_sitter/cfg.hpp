@@ -0,0 +1,851 @@
+#ifndef CPP_TREE_SITTER_CFG_H
+#define CPP_TREE_SITTER_CFG_H
+
+#include <limits>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "tree_sitter/batch.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/flat_tree.hpp"
+
+// Statement-level control-flow graphs for the C, C++, Go, Java, Rust and
+// Python grammars. The builder works on a flat_tree, so construction is index
+// arithmetic over preorder arrays rather than node API calls.
+//
+// Approximations: short-circuit operators and conditional expressions are not
+// split; `goto` and labelled break/continue jump to the exit block or the
+// innermost loop respectively; every block inside a `try` body gets an
+// exceptional edge to each handler, and a throw in a `try` without handlers
+// is treated as if the `try` were not there; `finally` only runs on normal
+// completion.
+
+namespace ts
+{
+
+    using block_id = uint32_t;
+
+    inline constexpr block_id no_block = std::numeric_limits<block_id>::max();
+
+    enum class cfg_edge_kind : uint8_t
+    {
+        normal,
+        true_branch,
+        false_branch,
+        back,
+        case_branch,
+        exceptional,
+        jump,
+    };
+
+    struct cfg_edge
+    {
+        block_id from;
+        block_id to;
+        cfg_edge_kind kind;
+    };
+
+    struct cfg_block
+    {
+        uint32_t first_statement;
+        uint32_t num_statements;
+    };
+
+    struct control_flow_graph
+    {
+        static constexpr block_id entry = 0;
+        static constexpr block_id exit = 1;
+
+        node_position function = no_position;
+        std::vector<cfg_block> blocks;
+        // Node positions of the statements of every block, grouped by block.
+        std::vector<node_position> statements;
+        std::vector<cfg_edge> edges;
+        // Block of each statement, indexed by node position minus `function`.
+        std::vector<block_id> node_blocks;
+
+        [[nodiscard]] auto get_statements(block_id block) const -> std::span<const node_position>
+        {
+            return {statements.data() + blocks[block].first_statement, blocks[block].num_statements};
+        }
+
+        // Returns the block holding the statement at `position`, or no_block.
+        [[nodiscard]] auto get_block_of(node_position position) const -> block_id
+        {
+            if (position < function || position - function >= node_blocks.size())
+            {
+                return no_block;
+            }
+            return node_blocks[position - function];
+        }
+    };
+
+    class cfg_builder
+    {
+    public:
+        explicit cfg_builder(language language)
+            : constructs(language.get_num_symbols(), construct::none)
+        {
+            for (const auto &[name, kind] : construct_names)
+            {
+                mark(language, name, kind);
+            }
+            else_symbol = language.get_symbol_for_name("else_clause", true);
+            match_arm_symbol = language.get_symbol_for_name("match_arm", true);
+
+            body_field = language.get_field_id_for_name("body");
+            condition_field = language.get_field_id_for_name("condition");
+            consequence_field = language.get_field_id_for_name("consequence");
+            alternative_field = language.get_field_id_for_name("alternative");
+            initializer_field = language.get_field_id_for_name("initializer");
+            init_field = language.get_field_id_for_name("init");
+            update_field = language.get_field_id_for_name("update");
+            value_field = language.get_field_id_for_name("value");
+            for (std::string_view name : {"value", "pattern", "type", "guard", "communication"})
+            {
+                if (field_id field = language.get_field_id_for_name(name))
+                {
+                    case_label_fields.push_back(field);
+                }
+            }
+        }
+
+        [[nodiscard]] auto is_function(const flat_tree &tree, node_position position) const -> bool
+        {
+            return get_construct(tree, position) == construct::function;
+        }
+
+        // Appends the position of every function, method and lambda in `tree`.
+        auto find_functions(const flat_tree &tree, std::vector<node_position> &functions) const -> void
+        {
+            for (node_position position = 0; position < tree.size(); ++position)
+            {
+                if (is_function(tree, position))
+                {
+                    functions.push_back(position);
+                }
+            }
+        }
+
+        // Builds the graph of the function at `position` into `graph`,
+        // reusing its allocations. Nested functions are single statements.
+        auto build(const flat_tree &tree, node_position function, control_flow_graph &graph) -> void
+        {
+            nodes = &tree;
+            this->graph = &graph;
+            graph.function = function;
+            graph.blocks.clear();
+            graph.statements.clear();
+            graph.edges.clear();
+            graph.node_blocks.assign(tree.get_subtree_end(function) - function, no_block);
+            pending.clear();
+            jumps.clear();
+            try_depth = 0;
+
+            new_block();
+            new_block();
+            block_id current = control_flow_graph::entry;
+            node_position body = tree.get_child_by_field_id(function, body_field);
+            if (body != no_position)
+            {
+                current = statement(body, current);
+            }
+            link(current, control_flow_graph::exit, cfg_edge_kind::normal);
+            finish();
+        }
+
+        [[nodiscard]] auto build(const flat_tree &tree, node_position function) -> control_flow_graph
+        {
+            control_flow_graph graph;
+            build(tree, function, graph);
+            return graph;
+        }
+
+    private:
+        enum class construct : uint8_t
+        {
+            none,
+            function,
+            sequence,
+            branch,
+            loop,
+            infinite_loop,
+            do_loop,
+            switch_,
+            // Pattern matches: `break` inside an arm leaves the enclosing
+            // loop, not the match.
+            match_,
+            exhaustive_match,
+            fallthrough_case,
+            case_,
+            default_case,
+            label,
+            try_,
+            handler,
+            finally_,
+            return_,
+            throw_,
+            break_,
+            continue_,
+            fallthrough,
+            jump,
+        };
+
+        static constexpr std::pair<std::string_view, construct> construct_names[] = {
+            {"function_definition", construct::function},
+            {"function_declaration", construct::function},
+            {"method_declaration", construct::function},
+            {"constructor_declaration", construct::function},
+            {"function_item", construct::function},
+            {"func_literal", construct::function},
+            {"lambda_expression", construct::function},
+            {"closure_expression", construct::function},
+            {"lambda", construct::function},
+            {"compound_statement", construct::sequence},
+            {"block", construct::sequence},
+            {"constructor_body", construct::sequence},
+            {"unsafe_block", construct::sequence},
+            {"switch_block", construct::sequence},
+            {"match_block", construct::sequence},
+            {"expression_statement", construct::sequence},
+            {"labeled_statement", construct::sequence},
+            {"else_clause", construct::sequence},
+            {"with_statement", construct::sequence},
+            {"if_statement", construct::branch},
+            {"if_expression", construct::branch},
+            {"if_let_expression", construct::branch},
+            {"elif_clause", construct::branch},
+            {"while_statement", construct::loop},
+            {"for_statement", construct::loop},
+            {"for_range_loop", construct::loop},
+            {"enhanced_for_statement", construct::loop},
+            {"while_expression", construct::loop},
+            {"while_let_expression", construct::loop},
+            {"for_expression", construct::loop},
+            {"loop_expression", construct::infinite_loop},
+            {"do_statement", construct::do_loop},
+            {"switch_statement", construct::switch_},
+            {"switch_expression", construct::switch_},
+            {"expression_switch_statement", construct::switch_},
+            {"type_switch_statement", construct::switch_},
+            {"select_statement", construct::switch_},
+            {"match_statement", construct::match_},
+            {"match_expression", construct::exhaustive_match},
+            {"case_statement", construct::fallthrough_case},
+            {"switch_block_statement_group", construct::fallthrough_case},
+            {"switch_rule", construct::case_},
+            {"expression_case", construct::case_},
+            {"type_case", construct::case_},
+            {"communication_case", construct::case_},
+            {"match_arm", construct::case_},
+            {"case_clause", construct::case_},
+            {"default_case", construct::default_case},
+            {"switch_label", construct::label},
+            {"case_pattern", construct::label},
+            {"try_statement", construct::try_},
+            {"try_with_resources_statement", construct::try_},
+            {"catch_clause", construct::handler},
+            {"except_clause", construct::handler},
+            {"except_group_clause", construct::handler},
+            {"finally_clause", construct::finally_},
+            {"return_statement", construct::return_},
+            {"return_expression", construct::return_},
+            {"throw_statement", construct::throw_},
+            {"throw_expression", construct::throw_},
+            {"raise_statement", construct::throw_},
+            {"break_statement", construct::break_},
+            {"break_expression", construct::break_},
+            {"continue_statement", construct::continue_},
+            {"continue_expression", construct::continue_},
+            {"fallthrough_statement", construct::fallthrough},
+            {"goto_statement", construct::jump},
+        };
+
+        struct jump_frame
+        {
+            block_id break_target;
+            block_id continue_target;
+            // Set by a Go `fallthrough` for the next case to pick up.
+            block_id fallthrough_from;
+        };
+
+        auto mark(language language, std::string_view name, construct kind) -> void
+        {
+            symbol id = language.get_symbol_for_name(name, true);
+            if (id != 0 && id < constructs.size())
+            {
+                constructs[id] = kind;
+            }
+        }
+
+        [[nodiscard]] auto get_construct(const flat_tree &tree, node_position position) const -> construct
+        {
+            symbol id = tree.get_symbol(position);
+            return id < constructs.size() && tree.is_named(position) ? constructs[id] : construct::none;
+        }
+
+        [[nodiscard]] auto kind_of(node_position position) const -> construct
+        {
+            return get_construct(*nodes, position);
+        }
+
+        // Calls fn(child) for each named, non-extra child.
+        template <typename Fn>
+        auto for_each_child(node_position position, Fn &&fn) const -> void
+        {
+            for (node_position child = nodes->get_first_child(position); child != no_position;
+                 child = nodes->get_next_sibling(child))
+            {
+                if (nodes->is_named(child) && !nodes->is_extra(child))
+                {
+                    fn(child);
+                }
+            }
+        }
+
+        auto new_block() -> block_id
+        {
+            graph->blocks.push_back({0, 0});
+            return static_cast<block_id>(graph->blocks.size() - 1);
+        }
+
+        auto link(block_id from, block_id to, cfg_edge_kind kind) -> void
+        {
+            if (from != no_block && to != no_block)
+            {
+                graph->edges.push_back({from, to, kind});
+            }
+        }
+
+        auto append(block_id block, node_position position) -> void
+        {
+            pending.emplace_back(block, position);
+        }
+
+        // Processes one statement entering at `current` and returns the block
+        // where control continues, or no_block if it cannot fall through.
+        auto statement(node_position position, block_id current) -> block_id
+        {
+            if (current == no_block)
+            {
+                // Unreachable code still gets a block, just without predecessors.
+                current = new_block();
+            }
+
+            switch (kind_of(position))
+            {
+            case construct::sequence:
+            case construct::handler:
+            case construct::finally_:
+                for_each_child(position, [&](node_position child) { current = statement(child, current); });
+                return current;
+            case construct::branch:
+                return branch(position, current);
+            case construct::loop:
+            case construct::infinite_loop:
+                return loop(position, current);
+            case construct::do_loop:
+                return do_loop(position, current);
+            case construct::switch_:
+            case construct::match_:
+            case construct::exhaustive_match:
+                return switch_(position, current);
+            case construct::try_:
+                return try_(position, current);
+            case construct::return_:
+                append(current, position);
+                link(current, control_flow_graph::exit, cfg_edge_kind::jump);
+                return no_block;
+            case construct::throw_:
+                append(current, position);
+                if (try_depth == 0)
+                {
+                    link(current, control_flow_graph::exit, cfg_edge_kind::exceptional);
+                }
+                return no_block;
+            case construct::break_:
+            case construct::continue_:
+            {
+                append(current, position);
+                bool is_break = kind_of(position) == construct::break_;
+                block_id target = control_flow_graph::exit;
+                for (auto it = jumps.rbegin(); it != jumps.rend(); ++it)
+                {
+                    block_id candidate = is_break ? it->break_target : it->continue_target;
+                    if (candidate != no_block)
+                    {
+                        target = candidate;
+                        break;
+                    }
+                }
+                link(current, target, cfg_edge_kind::jump);
+                return no_block;
+            }
+            case construct::fallthrough:
+                append(current, position);
+                if (!jumps.empty())
+                {
+                    jumps.back().fallthrough_from = current;
+                }
+                return no_block;
+            case construct::jump:
+                append(current, position);
+                link(current, control_flow_graph::exit, cfg_edge_kind::jump);
+                return no_block;
+            default:
+                append(current, position);
+                return current;
+            }
+        }
+
+        auto branch(node_position position, block_id current) -> block_id
+        {
+            block_id after = new_block();
+            link(chain(position, current, after), after, cfg_edge_kind::false_branch);
+            return after;
+        }
+
+        // Lays out one condition of an if/else-if chain and its alternatives.
+        // Returns the block whose false edge is still open, or no_block if the
+        // chain ends in an unconditional else.
+        auto chain(node_position position, block_id current, block_id after) -> block_id
+        {
+            node_position consequence = no_position;
+            for_each_child(position,
+                           [&](node_position child)
+                           {
+                               field_id field = nodes->get_field_id(child);
+                               if (field != 0 && field == consequence_field)
+                               {
+                                   consequence = child;
+                               }
+                               else if (field == 0 || field != alternative_field)
+                               {
+                                   append(current, child);
+                               }
+                           });
+
+            block_id then = new_block();
+            link(current, then, cfg_edge_kind::true_branch);
+            link(consequence != no_position ? statement(consequence, then) : then, after, cfg_edge_kind::normal);
+
+            block_id open = current;
+            if (alternative_field == 0)
+            {
+                return open;
+            }
+            for_each_child(position,
+                           [&](node_position child)
+                           {
+                               if (nodes->get_field_id(child) != alternative_field || open == no_block)
+                               {
+                                   return;
+                               }
+                               block_id next = new_block();
+                               link(open, next, cfg_edge_kind::false_branch);
+                               if (kind_of(child) == construct::branch)
+                               {
+                                   open = chain(child, next, after);
+                               }
+                               else
+                               {
+                                   link(statement(child, next), after, cfg_edge_kind::normal);
+                                   open = no_block;
+                               }
+                           });
+            return open;
+        }
+
+        auto loop(node_position position, block_id current) -> block_id
+        {
+            block_id header = new_block();
+            block_id after = new_block();
+            block_id latch = no_block;
+            node_position body = no_position;
+            node_position alternative = no_position;
+            bool has_condition = false;
+
+            for_each_child(position,
+                           [&](node_position child)
+                           {
+                               field_id field = nodes->get_field_id(child);
+                               if (field != 0 && field == body_field)
+                               {
+                                   body = child;
+                               }
+                               else if (field != 0 && field == alternative_field)
+                               {
+                                   alternative = child;
+                               }
+                               else if (field != 0 && (field == initializer_field || field == init_field))
+                               {
+                                   append(current, child);
+                               }
+                               else if (field != 0 && field == update_field)
+                               {
+                                   if (latch == no_block)
+                                   {
+                                       latch = new_block();
+                                   }
+                                   append(latch, child);
+                               }
+                               else
+                               {
+                                   append(header, child);
+                                   has_condition = true;
+                               }
+                           });
+
+            link(current, header, cfg_edge_kind::normal);
+            block_id continue_target = latch != no_block ? latch : header;
+            link(latch, header, cfg_edge_kind::back);
+
+            block_id body_entry = new_block();
+            link(header, body_entry, cfg_edge_kind::true_branch);
+            jumps.push_back({after, continue_target, no_block});
+            block_id body_exit = body != no_position ? statement(body, body_entry) : body_entry;
+            jumps.pop_back();
+            link(body_exit, continue_target, latch != no_block ? cfg_edge_kind::normal : cfg_edge_kind::back);
+
+            if (kind_of(position) != construct::infinite_loop && has_condition)
+            {
+                if (alternative != no_position)
+                {
+                    block_id otherwise = new_block();
+                    link(header, otherwise, cfg_edge_kind::false_branch);
+                    link(statement(alternative, otherwise), after, cfg_edge_kind::normal);
+                }
+                else
+                {
+                    link(header, after, cfg_edge_kind::false_branch);
+                }
+            }
+            return after;
+        }
+
+        auto do_loop(node_position position, block_id current) -> block_id
+        {
+            block_id body_entry = new_block();
+            block_id test = new_block();
+            block_id after = new_block();
+            link(current, body_entry, cfg_edge_kind::normal);
+
+            node_position body = nodes->get_child_by_field_id(position, body_field);
+            node_position condition = nodes->get_child_by_field_id(position, condition_field);
+            if (condition != no_position)
+            {
+                append(test, condition);
+            }
+
+            jumps.push_back({after, test, no_block});
+            block_id body_exit = body != no_position ? statement(body, body_entry) : body_entry;
+            jumps.pop_back();
+            link(body_exit, test, cfg_edge_kind::normal);
+            link(test, body_entry, cfg_edge_kind::back);
+            link(test, after, cfg_edge_kind::false_branch);
+            return after;
+        }
+
+        auto switch_(node_position position, block_id current) -> block_id
+        {
+            block_id after = new_block();
+            std::vector<node_position> cases;
+            for_each_child(position,
+                           [&](node_position child)
+                           {
+                               if (is_case(kind_of(child)))
+                               {
+                                   cases.push_back(child);
+                               }
+                               else if (kind_of(child) == construct::sequence)
+                               {
+                                   for_each_child(child,
+                                                  [&](node_position nested)
+                                                  {
+                                                      if (is_case(kind_of(nested)))
+                                                      {
+                                                          cases.push_back(nested);
+                                                      }
+                                                  });
+                               }
+                               else
+                               {
+                                   append(current, child);
+                               }
+                           });
+
+            bool has_default = kind_of(position) == construct::exhaustive_match;
+            block_id previous_exit = no_block;
+            // Matches still get a frame, without a break target, so that
+            // fallthrough stays local to them.
+            jumps.push_back({kind_of(position) == construct::switch_ ? after : no_block, no_block, no_block});
+            for (node_position arm : cases)
+            {
+                block_id entry = new_block();
+                link(current, entry, cfg_edge_kind::case_branch);
+                link(previous_exit, entry, cfg_edge_kind::normal);
+                link(jumps.back().fallthrough_from, entry, cfg_edge_kind::jump);
+                jumps.back().fallthrough_from = no_block;
+                has_default = has_default || is_default(arm);
+
+                block_id exit = case_body(arm, entry);
+                if (kind_of(arm) == construct::fallthrough_case)
+                {
+                    previous_exit = exit;
+                }
+                else
+                {
+                    link(exit, after, cfg_edge_kind::normal);
+                    previous_exit = no_block;
+                }
+            }
+            jumps.pop_back();
+
+            link(previous_exit, after, cfg_edge_kind::normal);
+            if (!has_default)
+            {
+                link(current, after, cfg_edge_kind::false_branch);
+            }
+            return after;
+        }
+
+        [[nodiscard]] static auto is_case(construct kind) -> bool
+        {
+            return kind == construct::fallthrough_case || kind == construct::case_ || kind == construct::default_case;
+        }
+
+        [[nodiscard]] auto is_default(node_position arm) const -> bool
+        {
+            if (kind_of(arm) == construct::default_case)
+            {
+                return true;
+            }
+            bool labelled = false;
+            bool has_value = false;
+            bool default_label = false;
+            for_each_child(arm,
+                           [&](node_position child)
+                           {
+                               has_value = has_value || (value_field != 0 && nodes->get_field_id(child) == value_field);
+                               if (kind_of(child) == construct::label)
+                               {
+                                   labelled = true;
+                                   default_label = default_label || nodes->get_first_child(child) == no_position ||
+                                                   !has_named_child(child);
+                               }
+                           });
+            if (labelled)
+            {
+                return default_label;
+            }
+            return kind_of(arm) == construct::fallthrough_case && !has_value;
+        }
+
+        [[nodiscard]] auto has_named_child(node_position position) const -> bool
+        {
+            bool found = false;
+            for_each_child(position, [&](node_position) { found = true; });
+            return found;
+        }
+
+        // Case labels are evaluated in the case's entry block; everything else
+        // is its body. A Rust match arm's `value` is its body.
+        auto case_body(node_position arm, block_id current) -> block_id
+        {
+            bool value_is_body = nodes->get_symbol(arm) == match_arm_symbol;
+            for_each_child(arm,
+                           [&](node_position child)
+                           {
+                               field_id field = nodes->get_field_id(child);
+                               bool is_label = kind_of(child) == construct::label;
+                               for (field_id label_field : case_label_fields)
+                               {
+                                   is_label = is_label || (field == label_field && !(value_is_body && field == value_field));
+                               }
+                               if (is_label)
+                               {
+                                   if (current == no_block)
+                                   {
+                                       current = new_block();
+                                   }
+                                   append(current, child);
+                               }
+                               else
+                               {
+                                   current = statement(child, current);
+                               }
+                           });
+            return current;
+        }
+
+        auto try_(node_position position, block_id current) -> block_id
+        {
+            block_id after = new_block();
+            node_position body = nodes->get_child_by_field_id(position, body_field);
+            node_position otherwise = no_position;
+            node_position finally = no_position;
+            std::vector<node_position> handlers;
+            for_each_child(position,
+                           [&](node_position child)
+                           {
+                               construct kind = kind_of(child);
+                               if (kind == construct::handler)
+                               {
+                                   handlers.push_back(child);
+                               }
+                               else if (kind == construct::finally_)
+                               {
+                                   finally = child;
+                               }
+                               else if (else_symbol != 0 && nodes->get_symbol(child) == else_symbol)
+                               {
+                                   otherwise = child;
+                               }
+                               else if (child != body)
+                               {
+                                   // Java try-with-resources declarations.
+                                   append(current, child);
+                               }
+                           });
+
+            block_id body_entry = new_block();
+            link(current, body_entry, cfg_edge_kind::normal);
+            // Without handlers nothing catches here, so throws in the body
+            // leave for the enclosing handlers or the exit block.
+            uint32_t depth = handlers.empty() ? 0 : 1;
+            try_depth += depth;
+            block_id exit = body != no_position ? statement(body, body_entry) : body_entry;
+            try_depth -= depth;
+            auto body_end = static_cast<block_id>(graph->blocks.size());
+
+            std::vector<block_id> handler_entries;
+            for (size_t i = 0; i < handlers.size(); ++i)
+            {
+                handler_entries.push_back(new_block());
+            }
+            for (block_id block = body_entry; block < body_end; ++block)
+            {
+                for (block_id handler : handler_entries)
+                {
+                    link(block, handler, cfg_edge_kind::exceptional);
+                }
+            }
+
+            if (otherwise != no_position && exit != no_block)
+            {
+                exit = statement(otherwise, exit);
+            }
+            block_id join = finally != no_position ? new_block() : after;
+            link(exit, join, cfg_edge_kind::normal);
+            for (size_t i = 0; i < handlers.size(); ++i)
+            {
+                link(statement(handlers[i], handler_entries[i]), join, cfg_edge_kind::normal);
+            }
+            if (finally != no_position)
+            {
+                link(statement(finally, join), after, cfg_edge_kind::normal);
+            }
+            return after;
+        }
+
+        // Groups the collected statements by block.
+        auto finish() -> void
+        {
+            for (const auto &[block, position] : pending)
+            {
+                ++graph->blocks[block].num_statements;
+            }
+            uint32_t offset = 0;
+            for (cfg_block &block : graph->blocks)
+            {
+                block.first_statement = offset;
+                offset += block.num_statements;
+                block.num_statements = 0;
+            }
+            graph->statements.resize(offset);
+            for (const auto &[block, position] : pending)
+            {
+                cfg_block &entry = graph->blocks[block];
+                graph->statements[entry.first_statement + entry.num_statements++] = position;
+                graph->node_blocks[position - graph->function] = block;
+            }
+        }
+
+        std::vector<construct> constructs;
+        symbol else_symbol = 0;
+        symbol match_arm_symbol = 0;
+        field_id body_field = 0;
+        field_id condition_field = 0;
+        field_id consequence_field = 0;
+        field_id alternative_field = 0;
+        field_id initializer_field = 0;
+        field_id init_field = 0;
+        field_id update_field = 0;
+        field_id value_field = 0;
+        std::vector<field_id> case_label_fields;
+
+        // Scratch state, reused across functions.
+        const flat_tree *nodes = nullptr;
+        control_flow_graph *graph = nullptr;
+        std::vector<std::pair<block_id, node_position>> pending;
+        std::vector<jump_frame> jumps;
+        uint32_t try_depth = 0;
+    };
+
+    // Parses every source in parallel and calls
+    // fn(tree, graph, source, index, worker) for each function found, with
+    // one flat_tree, builder and graph reused per worker.
+    template <typename Fn>
+    auto build_control_flow_graphs(language language,
+                                   std::span<const std::string_view> sources,
+                                   Fn &&fn,
+                                   unsigned threads = 0) -> void
+    {
+        struct worker_state
+        {
+            explicit worker_state(ts::language language)
+                : builder{language}
+            {
+            }
+
+            cfg_builder builder;
+            flat_tree tree;
+            control_flow_graph graph;
+            std::vector<node_position> functions;
+        };
+
+        unsigned num_workers = get_worker_count(sources.size(), threads);
+        std::vector<worker_state> workers;
+        workers.reserve(num_workers);
+        for (unsigned worker = 0; worker < num_workers; ++worker)
+        {
+            workers.emplace_back(language);
+        }
+
+        parse_each(
+            language,
+            sources,
+            [&](const tree &tree, std::string_view source, size_t index, unsigned worker)
+            {
+                worker_state &state = workers[worker];
+                state.tree.assign(tree.get_root_node());
+                state.functions.clear();
+                state.builder.find_functions(state.tree, state.functions);
+                for (node_position function : state.functions)
+                {
+                    state.builder.build(state.tree, function, state.graph);
+                    fn(static_cast<const flat_tree &>(state.tree),
+                       static_cast<const control_flow_graph &>(state.graph),
+                       source,
+                       index,
+                       worker);
+                }
+            },
+            num_workers);
+    }
+
+}
+
+#endif
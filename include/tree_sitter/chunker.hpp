@@ -0,0 +1,204 @@
+#ifndef CPP_TREE_SITTER_CHUNKER_H
+#define CPP_TREE_SITTER_CHUNKER_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "tree_sitter/batch.hpp"
+#include "tree_sitter/bundled.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/flat_tree.hpp"
+
+// Splits source files into chunks for retrieval indexes along syntax
+// boundaries. Siblings are packed greedily into chunks under a budget, so small
+// declarations and statements share a chunk while a node too big for one is
+// split among its children, recursively. A comment is a sibling like any
+// other, so it normally lands in the chunk with the code that follows it.
+//
+// Chunks tile the file: each starts where the previous one ended, so the
+// whitespace between two chunks belongs to the second.
+
+namespace ts
+{
+
+    enum class chunk_unit : uint8_t
+    {
+        bytes,
+        // Leaf tokens, a cheap stand-in for model tokens.
+        tokens,
+    };
+
+    struct chunk_options
+    {
+        uint32_t budget = 2048;
+        chunk_unit unit = chunk_unit::bytes;
+    };
+
+    struct code_chunk
+    {
+        extent<uint32_t> bytes;
+        extent<point> points;
+        // The node whose children were packed into this chunk, e.g. the
+        // class around a run of methods.
+        node_position parent;
+    };
+
+    class chunker
+    {
+    public:
+        explicit chunker(chunk_options options = {})
+            : options{options}
+        {
+        }
+
+        auto split(const flat_tree &tree, std::vector<code_chunk> &chunks) const -> void
+        {
+            if (tree.size() == 0)
+            {
+                return;
+            }
+
+            state state{tree, chunks, {}};
+            if (options.unit == chunk_unit::tokens)
+            {
+                state.leaves.assign(tree.size(), 0);
+                for (node_position position = tree.size(); position-- > 0;)
+                {
+                    if (tree.get_first_child(position) == no_position)
+                    {
+                        state.leaves[position] = 1;
+                    }
+                    if (position > 0)
+                    {
+                        state.leaves[tree.get_parent(position)] += state.leaves[position];
+                    }
+                }
+            }
+
+            size_t first = chunks.size();
+            pack(state, 0);
+            flush(state);
+            // Trailing text after the last child belongs to the last chunk.
+            extent<uint32_t> root_bytes = tree.get_byte_range(0);
+            if (chunks.size() > first && chunks.back().bytes.end < root_bytes.end)
+            {
+                chunks.back().bytes.end = root_bytes.end;
+                chunks.back().points.end = tree.get_node(0).get_point_range().end;
+            }
+            else if (chunks.size() == first)
+            {
+                chunks.push_back({root_bytes, tree.get_node(0).get_point_range(), 0});
+            }
+        }
+
+        [[nodiscard]] auto split(const flat_tree &tree) const -> std::vector<code_chunk>
+        {
+            std::vector<code_chunk> chunks;
+            split(tree, chunks);
+            return chunks;
+        }
+
+    private:
+        struct state
+        {
+            const flat_tree &tree;
+            std::vector<code_chunk> &chunks;
+            // Leaf count of every subtree, when measuring in tokens.
+            std::vector<uint32_t> leaves;
+            // The open chunk.
+            uint32_t start = 0;
+            point start_point{0, 0};
+            uint32_t end = 0;
+            point end_point{0, 0};
+            uint32_t tokens = 0;
+            node_position parent = 0;
+            bool open = false;
+        };
+
+        // Size of the open chunk if `position` were added to it.
+        [[nodiscard]] auto measure(const state &state, node_position position) const -> uint32_t
+        {
+            if (options.unit == chunk_unit::tokens)
+            {
+                return state.tokens + state.leaves[position];
+            }
+            return state.tree.get_byte_range(position).end - state.start;
+        }
+
+        auto add(state &state, node_position position) const -> void
+        {
+            state.end = state.tree.get_byte_range(position).end;
+            state.end_point = state.tree.get_node(position).get_point_range().end;
+            state.tokens += options.unit == chunk_unit::tokens ? state.leaves[position] : 0;
+            state.parent = state.tree.get_parent(position);
+            state.open = true;
+        }
+
+        auto flush(state &state) const -> void
+        {
+            if (!state.open)
+            {
+                return;
+            }
+            state.chunks.push_back({{state.start, state.end}, {state.start_point, state.end_point}, state.parent});
+            state.start = state.end;
+            state.start_point = state.end_point;
+            state.tokens = 0;
+            state.open = false;
+        }
+
+        auto pack(state &state, node_position parent) const -> void
+        {
+            const flat_tree &tree = state.tree;
+            for (node_position child = tree.get_first_child(parent); child != no_position;
+                 child = tree.get_next_sibling(child))
+            {
+                if (measure(state, child) <= options.budget)
+                {
+                    add(state, child);
+                    continue;
+                }
+                flush(state);
+                if (measure(state, child) <= options.budget || tree.get_first_child(child) == no_position)
+                {
+                    // Fits a chunk of its own, or is an oversized token that
+                    // cannot be split.
+                    add(state, child);
+                    continue;
+                }
+                pack(state, child);
+                flush(state);
+            }
+        }
+
+        chunk_options options;
+    };
+
+    // Parses and chunks every file in parallel; the chunks of files[i] are
+    // element i.
+    [[nodiscard]] inline auto chunk_sources(std::span<const source_file> files,
+                                            chunk_options options = {},
+                                            unsigned threads = 0) -> std::vector<std::vector<code_chunk>>
+    {
+        chunker chunker{options};
+        std::vector<std::vector<code_chunk>> results(files.size());
+        unsigned num_workers = get_worker_count(files.size(), threads);
+        parser_pool parsers{num_workers};
+        std::vector<flat_tree> trees(num_workers);
+        parallel_for(
+            files.size(),
+            [&](size_t index, unsigned worker)
+            {
+                const source_file &file = files[index];
+                tree tree = parsers.get(worker, get_language(file.language)).parse_string(file.text);
+                trees[worker].assign(tree.get_root_node());
+                chunker.split(trees[worker], results[index]);
+            },
+            num_workers);
+        return results;
+    }
+
+}
+
+#endif
@@ -0,0 +1,330 @@
+#ifndef CPP_TREE_SITTER_CODEMOD_H
+#define CPP_TREE_SITTER_CODEMOD_H
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "tree_sitter/batch.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/text_predicates.hpp"
+
+// Query-driven rewrites. All replacements for a file are collected from the
+// matches of one query, checked for overlaps and applied in a single rebuild
+// of the buffer. The same replacements, translated into TSInputEdits, bring
+// the old tree up to date so the result is validated by an incremental
+// reparse rather than a full one.
+
+namespace ts
+{
+
+    struct replacement
+    {
+        extent<uint32_t> bytes;
+        std::string text;
+    };
+
+    struct codemod_result
+    {
+        std::string text;
+        // Replacements in source order.
+        std::vector<replacement> applied;
+        // Replacements dropped because they overlapped an earlier one or fell
+        // outside the source.
+        std::vector<replacement> rejected;
+        // One edit per applied replacement, in the order they apply.
+        std::vector<TSInputEdit> edits;
+        // False if the rewritten text has more ERROR and MISSING nodes than
+        // the original. Exact for error-free input; for input that already
+        // had errors, a rewrite that removes one error and introduces another
+        // elsewhere still counts as valid.
+        bool valid = true;
+    };
+
+    namespace detail
+    {
+        [[nodiscard]] inline auto advance(point start, std::string_view text) -> point
+        {
+            size_t newline = text.find_last_of('\n');
+            if (newline == std::string_view::npos)
+            {
+                return {start.row, start.column + static_cast<uint32_t>(text.size())};
+            }
+            auto rows = static_cast<uint32_t>(std::count(text.begin(), text.end(), '\n'));
+            return {start.row + rows, static_cast<uint32_t>(text.size() - newline - 1)};
+        }
+
+        // Number of ERROR and MISSING nodes below `root`. Only subtrees that
+        // contain an error are entered, so an error-free tree costs one check.
+        [[nodiscard]] inline auto count_syntax_errors(node root) -> size_t
+        {
+            size_t count = 0;
+            cursor cursor{root.impl};
+            bool entering = true;
+            while (true)
+            {
+                if (entering)
+                {
+                    node current = cursor.get_current_node();
+                    if (current.is_error() || current.is_missing())
+                    {
+                        ++count;
+                    }
+                    else if (current.has_error() && cursor.goto_first_child())
+                    {
+                        continue;
+                    }
+                }
+                if (cursor.goto_next_sibling())
+                {
+                    entering = true;
+                    continue;
+                }
+                if (!cursor.goto_parent())
+                {
+                    return count;
+                }
+                entering = false;
+            }
+        }
+    }
+
+    // Applies `replacements` to `source` in one pass. Replacements are sorted
+    // by range; one overlapping an earlier one is rejected unless it is an
+    // exact duplicate, which is dropped. Replacing the same range twice, or
+    // inserting twice at the same offset, counts as overlapping.
+    [[nodiscard]] inline auto apply_replacements(std::string_view source, std::vector<replacement> replacements)
+        -> codemod_result
+    {
+        std::stable_sort(replacements.begin(),
+                         replacements.end(),
+                         [](const replacement &a, const replacement &b)
+                         {
+                             return a.bytes.start != b.bytes.start ? a.bytes.start < b.bytes.start
+                                                                   : a.bytes.end < b.bytes.end;
+                         });
+
+        codemod_result result;
+        result.text.reserve(source.size());
+        uint32_t copied = 0;
+        // Point of the end of result.text, advanced lazily.
+        size_t measured = 0;
+        point end_point{0, 0};
+        for (replacement &candidate : replacements)
+        {
+            extent<uint32_t> bytes = candidate.bytes;
+            if (bytes.start > bytes.end || bytes.end > source.size())
+            {
+                result.rejected.push_back(std::move(candidate));
+                continue;
+            }
+            if (!result.applied.empty())
+            {
+                const replacement &last = result.applied.back();
+                bool same_range = bytes.start == last.bytes.start && bytes.end == last.bytes.end;
+                if (same_range && candidate.text == last.text)
+                {
+                    continue;
+                }
+                if (same_range || bytes.start < last.bytes.end)
+                {
+                    result.rejected.push_back(std::move(candidate));
+                    continue;
+                }
+            }
+
+            result.text.append(source.substr(copied, bytes.start - copied));
+            end_point = detail::advance(end_point, std::string_view{result.text}.substr(measured));
+            measured = result.text.size();
+
+            std::string_view old_text = source.substr(bytes.start, bytes.end - bytes.start);
+            auto start_byte = static_cast<uint32_t>(result.text.size());
+            result.edits.push_back({start_byte,
+                                    start_byte + static_cast<uint32_t>(old_text.size()),
+                                    start_byte + static_cast<uint32_t>(candidate.text.size()),
+                                    end_point,
+                                    detail::advance(end_point, old_text),
+                                    detail::advance(end_point, candidate.text)});
+            result.text.append(candidate.text);
+            copied = bytes.end;
+            result.applied.push_back(std::move(candidate));
+        }
+        result.text.append(source.substr(copied));
+        return result;
+    }
+
+    class codemod
+    {
+    public:
+        // Called for each match that satisfies the query's text predicates;
+        // appends the replacements the match calls for.
+        using rewrite_function =
+            std::function<void(const query_match &match, std::string_view source, std::vector<replacement> &out)>;
+
+        // Throws query_error if the query does not compile.
+        codemod(language language, std::string_view query_source, rewrite_function rewrite)
+            : rewrites{language, query_source},
+              rewrite_predicates{rewrites},
+              rewrite{std::move(rewrite)}
+        {
+        }
+
+        // Replaces every node captured as @`target` with `replacement_template`,
+        // in which `{name}` stands for the text of capture @name in the same
+        // match. Throws query_error if the query does not compile or has no
+        // such capture.
+        codemod(language language,
+                std::string_view query_source,
+                std::string_view target,
+                std::string_view replacement_template)
+            : rewrites{language, query_source},
+              rewrite_predicates{rewrites}
+        {
+            std::optional<uint32_t> target_id = rewrites.get_capture_id(target);
+            if (!target_id)
+            {
+                throw query_error{0, TSQueryErrorCapture, "unknown capture @" + std::string{target}};
+            }
+            rewrite = [target = *target_id, segments = parse_template(replacement_template)](
+                          const query_match &match, std::string_view source, std::vector<replacement> &out)
+            {
+                for (uint32_t i = 0; i < match.get_num_captures(); ++i)
+                {
+                    if (match.get_capture_id(i) != target)
+                    {
+                        continue;
+                    }
+                    std::string text;
+                    for (const auto &[literal, capture] : segments)
+                    {
+                        text.append(literal);
+                        if (capture)
+                        {
+                            node captured = match.find_capture(*capture);
+                            if (!captured.is_null())
+                            {
+                                text.append(captured.get_source_range(source));
+                            }
+                        }
+                    }
+                    out.push_back({match.get_capture_node(i).get_byte_range(), std::move(text)});
+                }
+            };
+        }
+
+        [[nodiscard]] auto get_query() const -> const query &
+        {
+            return rewrites;
+        }
+
+        auto collect(const tree &tree,
+                     std::string_view source,
+                     query_cursor &cursor,
+                     std::vector<replacement> &replacements) const -> void
+        {
+            cursor.exec(rewrites, tree.get_root_node());
+            query_match match;
+            while (cursor.next_match(match))
+            {
+                if (rewrite_predicates.satisfies(match, source))
+                {
+                    rewrite(match, source, replacements);
+                }
+            }
+        }
+
+        // Rewrites `source`, which `tree` was parsed from. On return `tree`
+        // has been edited and incrementally reparsed to match result.text.
+        [[nodiscard]] auto apply(tree &tree, std::string_view source, parser &parser, query_cursor &cursor) const
+            -> codemod_result
+        {
+            std::vector<replacement> replacements;
+            collect(tree, source, cursor, replacements);
+            codemod_result result = apply_replacements(source, std::move(replacements));
+            if (result.edits.empty())
+            {
+                return result;
+            }
+
+            size_t errors_before = detail::count_syntax_errors(tree.get_root_node());
+            for (const TSInputEdit &edit : result.edits)
+            {
+                tree.edit(edit);
+            }
+            tree = parser.parse_string(tree, result.text);
+            result.valid = detail::count_syntax_errors(tree.get_root_node()) <= errors_before;
+            return result;
+        }
+
+    private:
+        struct segment
+        {
+            std::string literal;
+            std::optional<uint32_t> capture;
+        };
+
+        [[nodiscard]] auto parse_template(std::string_view text) const -> std::vector<segment>
+        {
+            std::vector<segment> segments(1);
+            while (!text.empty())
+            {
+                size_t open = text.find('{');
+                size_t close = open == std::string_view::npos ? open : text.find('}', open);
+                std::optional<uint32_t> capture;
+                if (close != std::string_view::npos)
+                {
+                    capture = rewrites.get_capture_id(text.substr(open + 1, close - open - 1));
+                }
+                if (!capture)
+                {
+                    // Not a placeholder; keep the text up to and including
+                    // the brace.
+                    size_t keep = open == std::string_view::npos ? text.size() : open + 1;
+                    segments.back().literal.append(text.substr(0, keep));
+                    text.remove_prefix(keep);
+                    continue;
+                }
+                segments.back().literal.append(text.substr(0, open));
+                segments.back().capture = capture;
+                segments.emplace_back();
+                text.remove_prefix(close + 1);
+            }
+            return segments;
+        }
+
+        query rewrites;
+        text_predicates rewrite_predicates;
+        rewrite_function rewrite;
+    };
+
+    // Applies `mod` to every source in parallel; the result for sources[i] is
+    // element i.
+    [[nodiscard]] inline auto apply_codemod(const codemod &mod,
+                                            language language,
+                                            std::span<const std::string_view> sources,
+                                            unsigned threads = 0) -> std::vector<codemod_result>
+    {
+        std::vector<codemod_result> results(sources.size());
+        unsigned num_workers = get_worker_count(sources.size(), threads);
+        parser_pool parsers{num_workers};
+        std::vector<query_cursor> cursors(num_workers);
+        parallel_for(
+            sources.size(),
+            [&](size_t index, unsigned worker)
+            {
+                parser &parser = parsers.get(worker, language);
+                tree tree = parser.parse_string(sources[index]);
+                results[index] = mod.apply(tree, sources[index], parser, cursors[worker]);
+            },
+            num_workers);
+        return results;
+    }
+
+}
+
+#endif
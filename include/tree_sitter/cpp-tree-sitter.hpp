@@ -1,8 +1,15 @@
 #ifndef CPP_TREE_SITTER_H
 #define CPP_TREE_SITTER_H
 
+#include <cstdlib>
 #include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <tree_sitter/api.h>
 #include <tree_sitter/parser.h>
@@ -48,6 +55,8 @@ namespace ts
 
     using symbol = uint16_t;
 
+    using field_id = uint16_t;
+
     using version = uint32_t;
 
     using node_id = uintptr_t;
@@ -78,6 +87,11 @@ namespace ts
             return ts_language_symbol_name(impl, symbol);
         }
 
+        [[nodiscard]] auto get_symbol_type(symbol symbol) const -> TSSymbolType
+        {
+            return ts_language_symbol_type(impl, symbol);
+        }
+
         [[nodiscard]] auto get_symbol_for_name(std::string_view name, bool isNamed) const -> symbol
         {
             return ts_language_symbol_for_name(impl,
@@ -86,6 +100,22 @@ namespace ts
                                                isNamed);
         }
 
+        [[nodiscard]] auto get_num_fields() const -> size_t
+        {
+            return ts_language_field_count(impl);
+        }
+
+        [[nodiscard]] auto get_field_name(field_id field) const -> std::string_view
+        {
+            char const *name = ts_language_field_name_for_id(impl, field);
+            return name ? name : std::string_view{};
+        }
+
+        [[nodiscard]] auto get_field_id_for_name(std::string_view name) const -> field_id
+        {
+            return ts_language_field_id_for_name(impl, name.data(), static_cast<uint32_t>(name.size()));
+        }
+
         [[nodiscard]] auto get_version() const -> version
         {
             return ts_language_version(impl);
@@ -131,11 +161,10 @@ namespace ts
             return ts_node_has_error(impl);
         }
 
-        // TODO: Not yet available in last release
-        // [[nodiscard]] bool
-        // isError() const {
-        //   return ts_node_is_error(impl);
-        // }
+        [[nodiscard]] auto is_error() const -> bool
+        {
+            return ts_node_is_error(impl);
+        }
 
         ////////////////////////////////////////////////////////////////
         // Navigation
@@ -153,6 +182,7 @@ namespace ts
             return node{ts_node_prev_sibling(impl)};
         }
 
+        // O(depth): copies the cursor stack, then takes one step.
         [[nodiscard]] auto get_next_sibling() const -> node
         {
             return node{ts_node_next_sibling(impl)};
@@ -168,6 +198,17 @@ namespace ts
             return node{ts_node_child(impl, position)};
         }
 
+        [[nodiscard]] auto get_descendant_count() const -> uint32_t
+        {
+            return ts_node_descendant_count(impl);
+        }
+
+        // Smallest descendant that spans `bytes`.
+        [[nodiscard]] auto get_descendant_for_byte_range(extent<uint32_t> bytes) const -> node
+        {
+            return node{ts_node_descendant_for_byte_range(impl, bytes.start, bytes.end)};
+        }
+
         // Named children
 
         [[nodiscard]] auto get_num_named_children() const -> uint32_t
@@ -251,12 +292,20 @@ namespace ts
 
     class tree
     {
+        friend class parser;
+
     public:
         tree(TSTree *tree)
             : impl{tree, ts_tree_delete}
         {
         }
 
+        // Trees are cheap to copy; the copy shares structure with the original.
+        [[nodiscard]] auto copy() const -> tree
+        {
+            return ts_tree_copy(impl.get());
+        }
+
         [[nodiscard]] auto get_root_node() const -> node
         {
             return node{ts_tree_root_node(impl.get())};
@@ -272,6 +321,22 @@ namespace ts
             return get_root_node().has_error();
         }
 
+        // Adjusts the tree for a source edit, ahead of an incremental reparse.
+        auto edit(const TSInputEdit &edit) -> void
+        {
+            ts_tree_edit(impl.get(), &edit);
+        }
+
+        // Returns the ranges whose syntactic structure differs between this
+        // (edited) tree and `new_tree`, which must be reparsed from it.
+        [[nodiscard]] auto get_changed_ranges(const tree &new_tree) const -> std::vector<TSRange>
+        {
+            uint32_t length = 0;
+            std::unique_ptr<TSRange, free_helper> ranges{
+                ts_tree_get_changed_ranges(impl.get(), new_tree.impl.get(), &length)};
+            return {ranges.get(), ranges.get() + length};
+        }
+
     private:
         std::unique_ptr<TSTree, decltype(&ts_tree_delete)> impl;
     };
@@ -285,12 +350,33 @@ namespace ts
             ts_parser_set_language(impl.get(), language.impl);
         }
 
+        [[nodiscard]] auto get_language() const -> language
+        {
+            return language{ts_parser_language(impl.get())};
+        }
+
+        auto set_language(language language) -> bool
+        {
+            return ts_parser_set_language(impl.get(), language.impl);
+        }
+
         [[nodiscard]] auto parse_string(std::string_view buffer) -> tree
         {
             return ts_parser_parse_string(
                 impl.get(),
                 nullptr,
-                &buffer.front(),
+                buffer.data(),
+                static_cast<uint32_t>(buffer.size()));
+        }
+
+        // Incremental reparse; `old_tree` must already have been edited to
+        // match `buffer`.
+        [[nodiscard]] auto parse_string(const tree &old_tree, std::string_view buffer) -> tree
+        {
+            return ts_parser_parse_string(
+                impl.get(),
+                old_tree.impl.get(),
+                buffer.data(),
                 static_cast<uint32_t>(buffer.size()));
         }
 
@@ -343,6 +429,12 @@ namespace ts
             return node{ts_tree_cursor_current_node(&impl)};
         }
 
+        // Returns the field of the current node within its parent, or 0.
+        [[nodiscard]] auto get_current_field_id() const -> field_id
+        {
+            return ts_tree_cursor_current_field_id(&impl);
+        }
+
         // Navigation
 
         [[nodiscard]] auto goto_parent() -> bool
@@ -366,6 +458,13 @@ namespace ts
             return ts_tree_cursor_goto_first_child(&impl);
         }
 
+        // Moves to the first child that extends past `byte` and returns its
+        // index, or returns -1 without moving if there is none.
+        [[nodiscard]] auto goto_first_child_for_byte(uint32_t byte) -> int64_t
+        {
+            return ts_tree_cursor_goto_first_child_for_byte(&impl, byte);
+        }
+
         // TODO: Not yet available in last release
         // [[nodiscard]] bool
         // gotoLastChild() {
@@ -382,6 +481,509 @@ namespace ts
         TSTreeCursor impl;
     };
 
+    // A node together with its ancestors, as recorded while walking down to it.
+    // Parent and ancestor lookups read the recorded stack. The path also keeps
+    // a tree cursor in step with the current node, so a sibling is one cursor
+    // step away. That step is taken on a copy of the cursor, so a sibling
+    // lookup costs O(depth) (copying the cursor stack) and not O(1); it does
+    // not grow with the child index, where node::get_next_sibling() would
+    // re-descend from the root and get_parent().get_child(i) would scan the
+    // parent's children. The previous sibling is O(1) when the path stepped
+    // here from it. Const lookups use the cursor internally, so a path must
+    // not be shared between threads.
+    class node_path
+    {
+    public:
+        node_path() = default;
+
+        explicit node_path(node root)
+        {
+            reset(root);
+        }
+
+        node_path(const node_path &other)
+            : nodes{other.nodes},
+              child_indices{other.child_indices},
+              previous_siblings{other.previous_siblings},
+              walker{ts_tree_cursor_copy(&other.walker)}
+        {
+        }
+
+        node_path(node_path &&other) noexcept
+            : nodes{std::move(other.nodes)},
+              child_indices{std::move(other.child_indices)},
+              previous_siblings{std::move(other.previous_siblings)},
+              walker{std::exchange(other.walker, TSTreeCursor{})}
+        {
+        }
+
+        auto operator=(node_path other) noexcept -> node_path &
+        {
+            std::swap(nodes, other.nodes);
+            std::swap(child_indices, other.child_indices);
+            std::swap(previous_siblings, other.previous_siblings);
+            std::swap(walker, other.walker);
+            return *this;
+        }
+
+        ~node_path()
+        {
+            ts_tree_cursor_delete(&walker);
+            ts_tree_cursor_delete(&probe);
+        }
+
+        auto reset(node root) -> void
+        {
+            nodes.assign(1, root);
+            child_indices.assign(1, 0);
+            previous_siblings.assign(1, TSNode{});
+            ts_tree_cursor_reset(&walker, root.impl);
+        }
+
+        [[nodiscard]] auto get_node() const -> node
+        {
+            return nodes.back();
+        }
+
+        [[nodiscard]] auto get_root() const -> node
+        {
+            return nodes.front();
+        }
+
+        // Number of ancestors below the root of the path.
+        [[nodiscard]] auto get_depth() const -> size_t
+        {
+            return nodes.size() - 1;
+        }
+
+        // Returns the ancestor `levels` above the current node (the node itself
+        // for 0), or a null node past the root of the path.
+        [[nodiscard]] auto get_ancestor(size_t levels) const -> node
+        {
+            return levels < nodes.size() ? nodes[nodes.size() - 1 - levels] : node{TSNode{}};
+        }
+
+        [[nodiscard]] auto get_parent() const -> node
+        {
+            return get_ancestor(1);
+        }
+
+        // Returns the nearest node on the path with the given symbol, starting
+        // from the current node, or a null node.
+        [[nodiscard]] auto find_ancestor(symbol symbol) const -> node
+        {
+            for (size_t i = nodes.size(); i-- > 0;)
+            {
+                if (nodes[i].get_symbol() == symbol)
+                {
+                    return nodes[i];
+                }
+            }
+            return node{TSNode{}};
+        }
+
+        // Position of the current node among the children of its parent.
+        [[nodiscard]] auto get_child_index() const -> uint32_t
+        {
+            return child_indices.back();
+        }
+
+        // O(depth): copies the cursor stack, then takes one step.
+        [[nodiscard]] auto get_next_sibling() const -> node
+        {
+            if (nodes.size() <= 1)
+            {
+                return node{TSNode{}};
+            }
+            ts_tree_cursor_reset_to(&probe, &walker);
+            return ts_tree_cursor_goto_next_sibling(&probe) ? node{ts_tree_cursor_current_node(&probe)}
+                                                            : node{TSNode{}};
+        }
+
+        // O(1) when the path stepped here from the previous sibling; otherwise
+        // a cursor copy and a backwards step, which may also rescan the
+        // preceding siblings to recover the column of the result.
+        [[nodiscard]] auto get_previous_sibling() const -> node
+        {
+            if (nodes.size() <= 1 || get_child_index() == 0)
+            {
+                return node{TSNode{}};
+            }
+            if (!ts_node_is_null(previous_siblings.back()))
+            {
+                return node{previous_siblings.back()};
+            }
+            ts_tree_cursor_reset_to(&probe, &walker);
+            return ts_tree_cursor_goto_previous_sibling(&probe) ? node{ts_tree_cursor_current_node(&probe)}
+                                                                : node{TSNode{}};
+        }
+
+        // Steps used by walks that maintain a path alongside a cursor. The
+        // path's own cursor follows them: pushing child i takes i + 1 steps,
+        // the same as the walk that found it.
+
+        auto push_child(node child, uint32_t child_index) -> void
+        {
+            nodes.push_back(child);
+            child_indices.push_back(child_index);
+            previous_siblings.push_back(TSNode{});
+            if (ts_tree_cursor_goto_first_child(&walker))
+            {
+                for (uint32_t i = 0; i < child_index && ts_tree_cursor_goto_next_sibling(&walker); ++i)
+                {
+                }
+            }
+        }
+
+        auto move_to_next_sibling(node sibling) -> void
+        {
+            previous_siblings.back() = nodes.back().impl;
+            nodes.back() = sibling;
+            ++child_indices.back();
+            (void)ts_tree_cursor_goto_next_sibling(&walker);
+        }
+
+        auto pop() -> void
+        {
+            nodes.pop_back();
+            child_indices.pop_back();
+            previous_siblings.pop_back();
+            (void)ts_tree_cursor_goto_parent(&walker);
+        }
+
+        // Moves the path to `target`, keeping the ancestors it shares with the
+        // current node and descending from there with `cursor`. Moving forward
+        // in document order, as when following query captures, only walks the
+        // part of the tree between the two nodes. Returns false, leaving the
+        // path at the deepest shared ancestor, if `target` is not below the
+        // root of the path.
+        auto seek(node target, cursor &cursor) -> bool
+        {
+            extent<uint32_t> bytes = target.get_byte_range();
+            auto contains = [&](node candidate)
+            {
+                extent<uint32_t> range = candidate.get_byte_range();
+                return range.start <= bytes.start && bytes.end <= range.end;
+            };
+
+            while (nodes.size() > 1 && !contains(nodes.back()))
+            {
+                pop();
+            }
+            // The target may itself be on the path, above wrappers that share
+            // its range.
+            for (size_t i = nodes.size(); i-- > 0 && contains(nodes[i]);)
+            {
+                if (nodes[i].get_id() == target.get_id())
+                {
+                    while (nodes.size() > i + 1)
+                    {
+                        pop();
+                    }
+                    return true;
+                }
+            }
+
+            size_t base = nodes.size();
+            cursor.reset(nodes.back());
+            if (!cursor.goto_first_child())
+            {
+                return false;
+            }
+            push_child(cursor.get_current_node(), 0);
+            for (;;)
+            {
+                if (contains(nodes.back()))
+                {
+                    if (nodes.back().get_id() == target.get_id())
+                    {
+                        return true;
+                    }
+                    if (cursor.goto_first_child())
+                    {
+                        push_child(cursor.get_current_node(), 0);
+                        continue;
+                    }
+                }
+                // Siblings starting after the target cannot contain it. The
+                // cursor was reset at the shared ancestor, so stop there
+                // rather than trying its siblings.
+                while (nodes.back().get_byte_range().start > bytes.start || !cursor.goto_next_sibling())
+                {
+                    pop();
+                    if (nodes.size() == base)
+                    {
+                        return false;
+                    }
+                    (void)cursor.goto_parent();
+                }
+                move_to_next_sibling(cursor.get_current_node());
+            }
+        }
+
+        auto seek(node target) -> bool
+        {
+            cursor cursor{nodes.back().impl};
+            return seek(target, cursor);
+        }
+
+    private:
+        std::vector<node> nodes;
+        std::vector<uint32_t> child_indices;
+        // The sibling the path last stepped from at each level, or null.
+        std::vector<TSNode> previous_siblings;
+        TSTreeCursor walker{};
+        mutable TSTreeCursor probe{};
+    };
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Queries.
+    /////////////////////////////////////////////////////////////////////////////
+
+    class query_error : public std::runtime_error
+    {
+    public:
+        query_error(uint32_t offset, TSQueryError type)
+            : std::runtime_error{"invalid query at offset " + std::to_string(offset)},
+              offset{offset},
+              type{type}
+        {
+        }
+
+        query_error(uint32_t offset, TSQueryError type, const std::string &message)
+            : std::runtime_error{message},
+              offset{offset},
+              type{type}
+        {
+        }
+
+        uint32_t offset;
+        TSQueryError type;
+    };
+
+    // A single match produced by a query cursor. The captures point into the
+    // cursor's storage and are only valid until the cursor is advanced.
+    struct query_match
+    {
+        query_match() = default;
+
+        explicit query_match(TSQueryMatch match)
+            : impl{match}
+        {
+        }
+
+        [[nodiscard]] auto get_id() const -> uint32_t
+        {
+            return impl.id;
+        }
+
+        [[nodiscard]] auto get_pattern_index() const -> uint32_t
+        {
+            return impl.pattern_index;
+        }
+
+        [[nodiscard]] auto get_num_captures() const -> uint32_t
+        {
+            return impl.capture_count;
+        }
+
+        [[nodiscard]] auto get_capture_node(uint32_t position) const -> node
+        {
+            return node{impl.captures[position].node};
+        }
+
+        [[nodiscard]] auto get_capture_id(uint32_t position) const -> uint32_t
+        {
+            return impl.captures[position].index;
+        }
+
+        // Returns the first node captured as `capture_id`, or a null node.
+        [[nodiscard]] auto find_capture(uint32_t capture_id) const -> node
+        {
+            for (uint32_t i = 0; i < impl.capture_count; ++i)
+            {
+                if (impl.captures[i].index == capture_id)
+                {
+                    return node{impl.captures[i].node};
+                }
+            }
+            return node{TSNode{}};
+        }
+
+        TSQueryMatch impl{};
+    };
+
+    class query
+    {
+        friend class query_cursor;
+        friend class text_predicates;
+
+    public:
+        // Throws query_error if the source does not compile for the language.
+        query(language language, std::string_view source)
+            : impl{nullptr, ts_query_delete}
+        {
+            uint32_t error_offset = 0;
+            TSQueryError error_type = TSQueryErrorNone;
+            impl.reset(ts_query_new(language.impl,
+                                    source.data(),
+                                    static_cast<uint32_t>(source.size()),
+                                    &error_offset,
+                                    &error_type));
+            if (!impl)
+            {
+                throw query_error{error_offset, error_type};
+            }
+
+            uint32_t num_captures = ts_query_capture_count(impl.get());
+            capture_names.reserve(num_captures);
+            for (uint32_t id = 0; id < num_captures; ++id)
+            {
+                uint32_t length = 0;
+                char const *name = ts_query_capture_name_for_id(impl.get(), id, &length);
+                capture_names.emplace_back(name, length);
+            }
+            load_properties();
+        }
+
+        [[nodiscard]] auto get_num_patterns() const -> uint32_t
+        {
+            return ts_query_pattern_count(impl.get());
+        }
+
+        [[nodiscard]] auto get_num_captures() const -> uint32_t
+        {
+            return static_cast<uint32_t>(capture_names.size());
+        }
+
+        [[nodiscard]] auto get_capture_name(uint32_t capture_id) const -> std::string_view
+        {
+            return capture_names[capture_id];
+        }
+
+        [[nodiscard]] auto get_capture_id(std::string_view name) const -> std::optional<uint32_t>
+        {
+            for (uint32_t id = 0; id < capture_names.size(); ++id)
+            {
+                if (capture_names[id] == name)
+                {
+                    return id;
+                }
+            }
+            return std::nullopt;
+        }
+
+        [[nodiscard]] auto get_pattern_start_byte(uint32_t pattern_index) const -> uint32_t
+        {
+            return ts_query_start_byte_for_pattern(impl.get(), pattern_index);
+        }
+
+        // Returns the value of a `(#set! key value)` directive on a pattern.
+        [[nodiscard]] auto get_property(uint32_t pattern_index, std::string_view key) const
+            -> std::optional<std::string_view>
+        {
+            if (pattern_index < properties.size())
+            {
+                for (const auto &[name, value] : properties[pattern_index])
+                {
+                    if (name == key)
+                    {
+                        return value;
+                    }
+                }
+            }
+            return std::nullopt;
+        }
+
+    private:
+        auto load_properties() -> void
+        {
+            uint32_t num_patterns = get_num_patterns();
+            for (uint32_t pattern_index = 0; pattern_index < num_patterns; ++pattern_index)
+            {
+                uint32_t num_steps = 0;
+                TSQueryPredicateStep const *steps =
+                    ts_query_predicates_for_pattern(impl.get(), pattern_index, &num_steps);
+
+                // Each predicate is a run of steps terminated by a Done step:
+                // the name string first, followed by its arguments.
+                uint32_t begin = 0;
+                for (uint32_t end = 0; end < num_steps; ++end)
+                {
+                    if (steps[end].type != TSQueryPredicateStepTypeDone)
+                    {
+                        continue;
+                    }
+                    add_property(pattern_index, steps + begin, end - begin);
+                    begin = end + 1;
+                }
+            }
+        }
+
+        auto add_property(uint32_t pattern_index, TSQueryPredicateStep const *steps, uint32_t num_steps) -> void
+        {
+            // Text predicates are evaluated by ts::text_predicates.
+            if (num_steps < 2 || num_steps > 3 || steps[0].type != TSQueryPredicateStepTypeString ||
+                get_string_value(steps[0].value_id) != "set!" || steps[1].type != TSQueryPredicateStepTypeString)
+            {
+                return;
+            }
+            if (properties.size() <= pattern_index)
+            {
+                properties.resize(pattern_index + 1);
+            }
+            std::string_view value;
+            if (num_steps == 3 && steps[2].type == TSQueryPredicateStepTypeString)
+            {
+                value = get_string_value(steps[2].value_id);
+            }
+            properties[pattern_index].emplace_back(get_string_value(steps[1].value_id), value);
+        }
+
+        [[nodiscard]] auto get_string_value(uint32_t id) const -> std::string_view
+        {
+            uint32_t length = 0;
+            char const *value = ts_query_string_value_for_id(impl.get(), id, &length);
+            return {value, length};
+        }
+
+        std::unique_ptr<TSQuery, decltype(&ts_query_delete)> impl;
+        std::vector<std::string_view> capture_names;
+        std::vector<std::vector<std::pair<std::string_view, std::string_view>>> properties;
+    };
+
+    class query_cursor
+    {
+    public:
+        query_cursor()
+            : impl{ts_query_cursor_new(), ts_query_cursor_delete}
+        {
+        }
+
+        auto exec(const query &query, node node) -> void
+        {
+            ts_query_cursor_exec(impl.get(), query.impl.get(), node.impl);
+        }
+
+        auto set_byte_range(extent<uint32_t> range) -> void
+        {
+            ts_query_cursor_set_byte_range(impl.get(), range.start, range.end);
+        }
+
+        [[nodiscard]] auto next_match(query_match &match) -> bool
+        {
+            return ts_query_cursor_next_match(impl.get(), &match.impl);
+        }
+
+        [[nodiscard]] auto next_capture(query_match &match, uint32_t &capture_position) -> bool
+        {
+            return ts_query_cursor_next_capture(impl.get(), &match.impl, &capture_position);
+        }
+
+    private:
+        std::unique_ptr<TSQueryCursor, decltype(&ts_query_cursor_delete)> impl;
+    };
+
     // To avoid cyclic dependencies and ODR violations, we define all methods
     // *using* Cursors inline after the definition of Cursor itself.
     [[nodiscard]] auto inline node::get_cursor() const -> cursor
@@ -389,6 +991,93 @@ namespace ts
         return cursor{impl};
     }
 
+    // Calls fn(node) for `root` and each of its descendants in document order
+    // using a single cursor. If fn returns bool, returning false skips the
+    // children of that node. If fn takes a `const node_path &` instead, it is
+    // given the path from `root` to each node.
+    template <typename Fn>
+    auto visit(node root, Fn &&fn) -> void
+    {
+        constexpr bool wants_path = !std::is_invocable_v<Fn &, node>;
+        using argument = std::conditional_t<wants_path, const node_path &, node>;
+
+        cursor cursor{root.impl};
+        node_path path;
+        if constexpr (wants_path)
+        {
+            path.reset(root);
+        }
+        for (;;)
+        {
+            argument current = [&]() -> argument
+            {
+                if constexpr (wants_path)
+                {
+                    return path;
+                }
+                else
+                {
+                    return cursor.get_current_node();
+                }
+            }();
+
+            bool descend = true;
+            if constexpr (std::is_same_v<std::invoke_result_t<Fn &, argument>, bool>)
+            {
+                descend = fn(current);
+            }
+            else
+            {
+                fn(current);
+            }
+
+            if (descend && cursor.goto_first_child())
+            {
+                if constexpr (wants_path)
+                {
+                    path.push_child(cursor.get_current_node(), 0);
+                }
+                continue;
+            }
+            while (!cursor.goto_next_sibling())
+            {
+                if (!cursor.goto_parent())
+                {
+                    return;
+                }
+                if constexpr (wants_path)
+                {
+                    path.pop();
+                }
+            }
+            if constexpr (wants_path)
+            {
+                path.move_to_next_sibling(cursor.get_current_node());
+            }
+        }
+    }
+
+    // Runs `query` over `root` and calls fn(path, match, capture_position) for
+    // each capture in document order, where `path` leads from `root` to the
+    // captured node. Consecutive captures share their common ancestors, so
+    // the paths cost one forward walk over the tree in total.
+    template <typename Fn>
+    auto visit_captures(const query &query, node root, query_cursor &query_cursor, Fn &&fn) -> void
+    {
+        node_path path{root};
+        cursor cursor{root.impl};
+        query_cursor.exec(query, root);
+        query_match match;
+        uint32_t position = 0;
+        while (query_cursor.next_capture(match, position))
+        {
+            if (path.seek(match.get_capture_node(position), cursor))
+            {
+                fn(std::as_const(path), std::as_const(match), position);
+            }
+        }
+    }
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,236 @@
+#ifndef CPP_TREE_SITTER_DOC_COMMENTS_H
+#define CPP_TREE_SITTER_DOC_COMMENTS_H
+
+#include <limits>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "tree_sitter/cpp-tree-sitter.hpp"
+
+// Pairs runs of comments with the declaration that follows them, in one
+// preorder walk instead of sibling navigation per declaration.
+//
+// A run is a sequence of comments on consecutive lines, each on its own line
+// (a trailing comment after code never starts one). It documents the next
+// declaration if that starts on the line after the run, skipping over
+// attributes such as Rust's `#[derive]`. Declaration node types come from a
+// shared table covering every bundled grammar.
+
+namespace ts
+{
+
+    struct doc_association
+    {
+        // Range into doc_table::comments.
+        uint32_t first_comment;
+        uint32_t num_comments;
+        node declaration;
+    };
+
+    struct doc_table
+    {
+        std::vector<extent<uint32_t>> comments;
+        std::vector<doc_association> associations;
+    };
+
+    class doc_comment_associator
+    {
+    public:
+        explicit doc_comment_associator(language language)
+            : roles(language.get_num_symbols(), role::other)
+        {
+            for (const auto &[name, kind] : role_names)
+            {
+                symbol id = language.get_symbol_for_name(name, true);
+                if (id != 0 && id < roles.size())
+                {
+                    roles[id] = kind;
+                }
+            }
+        }
+
+        auto associate(const tree &tree, doc_table &table) const -> void
+        {
+            table.comments.clear();
+            table.associations.clear();
+
+            constexpr uint32_t no_row = std::numeric_limits<uint32_t>::max();
+            uint32_t run_start = 0;
+            uint32_t run_end_row = no_row;
+            uint32_t last_code_row = no_row;
+            auto reset = [&]()
+            {
+                table.comments.resize(run_start);
+                run_end_row = no_row;
+            };
+
+            visit(tree.get_root_node(),
+                  [&](node node) -> bool
+                  {
+                      role kind = get_role(node);
+                      extent<point> points = node.get_point_range();
+
+                      if (kind == role::comment)
+                      {
+                          bool own_line = last_code_row == no_row || points.start.row > last_code_row;
+                          bool continues = run_end_row != no_row && points.start.row <= run_end_row + 1;
+                          if (!continues)
+                          {
+                              reset();
+                          }
+                          if (own_line)
+                          {
+                              table.comments.push_back(node.get_byte_range());
+                              run_end_row = points.end.row;
+                          }
+                          return false;
+                      }
+                      if (node.is_extra())
+                      {
+                          return false;
+                      }
+
+                      bool adjacent = run_end_row != no_row && points.start.row <= run_end_row + 1;
+                      if (!adjacent)
+                      {
+                          reset();
+                      }
+
+                      switch (kind)
+                      {
+                      case role::declaration:
+                          if (adjacent)
+                          {
+                              table.associations.push_back({run_start,
+                                                            static_cast<uint32_t>(table.comments.size()) - run_start,
+                                                            node});
+                              run_start = static_cast<uint32_t>(table.comments.size());
+                              run_end_row = no_row;
+                          }
+                          return true;
+                      case role::attribute:
+                          if (adjacent)
+                          {
+                              run_end_row = points.end.row;
+                          }
+                          last_code_row = points.end.row;
+                          return false;
+                      default:
+                          // Descend through named wrappers looking for a
+                          // declaration that starts with them; any token in
+                          // between ends the run.
+                          if (node.get_num_children() == 0 || !node.is_named())
+                          {
+                              reset();
+                              last_code_row = points.end.row;
+                          }
+                          return true;
+                      }
+                  });
+            reset();
+        }
+
+        [[nodiscard]] auto associate(const tree &tree) const -> doc_table
+        {
+            doc_table table;
+            associate(tree, table);
+            return table;
+        }
+
+    private:
+        enum class role : uint8_t
+        {
+            other,
+            comment,
+            declaration,
+            attribute,
+        };
+
+        static constexpr std::pair<std::string_view, role> role_names[] = {
+            {"comment", role::comment},
+            {"line_comment", role::comment},
+            {"block_comment", role::comment},
+            {"attribute_item", role::attribute},
+            // C and C++
+            {"function_definition", role::declaration},
+            {"declaration", role::declaration},
+            {"field_declaration", role::declaration},
+            {"type_definition", role::declaration},
+            {"struct_specifier", role::declaration},
+            {"union_specifier", role::declaration},
+            {"enum_specifier", role::declaration},
+            {"enumerator", role::declaration},
+            {"class_specifier", role::declaration},
+            {"namespace_definition", role::declaration},
+            {"template_declaration", role::declaration},
+            {"alias_declaration", role::declaration},
+            {"preproc_def", role::declaration},
+            {"preproc_function_def", role::declaration},
+            // C#
+            {"class_declaration", role::declaration},
+            {"struct_declaration", role::declaration},
+            {"interface_declaration", role::declaration},
+            {"enum_declaration", role::declaration},
+            {"enum_member_declaration", role::declaration},
+            {"record_declaration", role::declaration},
+            {"delegate_declaration", role::declaration},
+            {"event_declaration", role::declaration},
+            {"property_declaration", role::declaration},
+            {"namespace_declaration", role::declaration},
+            {"method_declaration", role::declaration},
+            {"constructor_declaration", role::declaration},
+            // Go
+            {"function_declaration", role::declaration},
+            {"type_declaration", role::declaration},
+            {"const_declaration", role::declaration},
+            {"var_declaration", role::declaration},
+            {"method_spec", role::declaration},
+            // Java
+            {"annotation_type_declaration", role::declaration},
+            {"constant_declaration", role::declaration},
+            {"enum_constant", role::declaration},
+            // JavaScript and TypeScript
+            {"generator_function_declaration", role::declaration},
+            {"lexical_declaration", role::declaration},
+            {"variable_declaration", role::declaration},
+            {"method_definition", role::declaration},
+            {"field_definition", role::declaration},
+            {"public_field_definition", role::declaration},
+            {"export_statement", role::declaration},
+            {"abstract_class_declaration", role::declaration},
+            {"type_alias_declaration", role::declaration},
+            {"property_signature", role::declaration},
+            {"method_signature", role::declaration},
+            {"module", role::declaration},
+            // Python
+            {"class_definition", role::declaration},
+            {"decorated_definition", role::declaration},
+            // Rust
+            {"function_item", role::declaration},
+            {"function_signature_item", role::declaration},
+            {"struct_item", role::declaration},
+            {"enum_item", role::declaration},
+            {"enum_variant", role::declaration},
+            {"union_item", role::declaration},
+            {"trait_item", role::declaration},
+            {"impl_item", role::declaration},
+            {"mod_item", role::declaration},
+            {"const_item", role::declaration},
+            {"static_item", role::declaration},
+            {"type_item", role::declaration},
+            {"macro_definition", role::declaration},
+        };
+
+        [[nodiscard]] auto get_role(node node) const -> role
+        {
+            symbol id = node.get_symbol();
+            return id < roles.size() && node.is_named() ? roles[id] : role::other;
+        }
+
+        std::vector<role> roles;
+    };
+
+}
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef CPP_TREE_SITTER_FLAT_TREE_H
+#define CPP_TREE_SITTER_FLAT_TREE_H
+
+#include <limits>
+#include <vector>
+
+#include "tree_sitter/cpp-tree-sitter.hpp"
+
+namespace ts
+{
+
+    // Preorder position of a node within a flat_tree.
+    using node_position = uint32_t;
+
+    inline constexpr node_position no_position = std::numeric_limits<node_position>::max();
+
+    // A syntax tree flattened into preorder arrays in one cursor walk. Parent,
+    // child and sibling steps become index arithmetic: the children of `p`
+    // start at p + 1 and the subtree of `p` ends (exclusively) at
+    // get_subtree_end(p), which is also where its next sibling starts.
+    class flat_tree
+    {
+    public:
+        flat_tree() = default;
+
+        explicit flat_tree(node root)
+        {
+            assign(root);
+        }
+
+        // Re-flattens from `root`, reusing the existing allocations.
+        auto assign(node root) -> void
+        {
+            nodes.clear();
+            symbols.clear();
+            fields.clear();
+            flags.clear();
+            parents.clear();
+            ends.clear();
+            depths.clear();
+            if (root.is_null())
+            {
+                return;
+            }
+
+            size_t expected = root.get_descendant_count();
+            nodes.reserve(expected);
+            symbols.reserve(expected);
+            fields.reserve(expected);
+            flags.reserve(expected);
+            parents.reserve(expected);
+            ends.reserve(expected);
+            depths.reserve(expected);
+
+            std::vector<node_position> stack;
+            cursor cursor{root.impl};
+            for (;;)
+            {
+                node current = cursor.get_current_node();
+                auto position = static_cast<node_position>(nodes.size());
+                nodes.push_back(current.impl);
+                symbols.push_back(current.get_symbol());
+                fields.push_back(stack.empty() ? field_id{0} : cursor.get_current_field_id());
+                flags.push_back(static_cast<uint8_t>((current.is_named() ? named_flag : 0) |
+                                                     (current.is_extra() ? extra_flag : 0) |
+                                                     (current.is_missing() ? missing_flag : 0)));
+                parents.push_back(stack.empty() ? no_position : stack.back());
+                ends.push_back(position + 1);
+                depths.push_back(static_cast<uint32_t>(stack.size()));
+
+                if (cursor.goto_first_child())
+                {
+                    stack.push_back(position);
+                    continue;
+                }
+                while (!cursor.goto_next_sibling())
+                {
+                    if (!cursor.goto_parent())
+                    {
+                        return;
+                    }
+                    ends[stack.back()] = static_cast<node_position>(nodes.size());
+                    stack.pop_back();
+                }
+            }
+        }
+
+        [[nodiscard]] auto size() const -> node_position
+        {
+            return static_cast<node_position>(nodes.size());
+        }
+
+        [[nodiscard]] auto get_node(node_position position) const -> node
+        {
+            return node{nodes[position]};
+        }
+
+        [[nodiscard]] auto get_symbol(node_position position) const -> symbol
+        {
+            return symbols[position];
+        }
+
+        // Field of the node within its parent, or 0.
+        [[nodiscard]] auto get_field_id(node_position position) const -> field_id
+        {
+            return fields[position];
+        }
+
+        [[nodiscard]] auto is_named(node_position position) const -> bool
+        {
+            return flags[position] & named_flag;
+        }
+
+        [[nodiscard]] auto is_extra(node_position position) const -> bool
+        {
+            return flags[position] & extra_flag;
+        }
+
+        [[nodiscard]] auto is_missing(node_position position) const -> bool
+        {
+            return flags[position] & missing_flag;
+        }
+
+        [[nodiscard]] auto get_parent(node_position position) const -> node_position
+        {
+            return parents[position];
+        }
+
+        [[nodiscard]] auto get_depth(node_position position) const -> uint32_t
+        {
+            return depths[position];
+        }
+
+        // One past the last descendant of `position`.
+        [[nodiscard]] auto get_subtree_end(node_position position) const -> node_position
+        {
+            return ends[position];
+        }
+
+        [[nodiscard]] auto get_first_child(node_position position) const -> node_position
+        {
+            return ends[position] > position + 1 ? position + 1 : no_position;
+        }
+
+        [[nodiscard]] auto get_next_sibling(node_position position) const -> node_position
+        {
+            node_position parent = parents[position];
+            return parent != no_position && ends[position] < ends[parent] ? ends[position] : no_position;
+        }
+
+        // Returns the first child of `position` in `field`, or no_position.
+        [[nodiscard]] auto get_child_by_field_id(node_position position, field_id field) const -> node_position
+        {
+            if (field == 0)
+            {
+                return no_position;
+            }
+            for (node_position child = get_first_child(position); child != no_position; child = get_next_sibling(child))
+            {
+                if (fields[child] == field)
+                {
+                    return child;
+                }
+            }
+            return no_position;
+        }
+
+        [[nodiscard]] auto is_ancestor(node_position ancestor, node_position descendant) const -> bool
+        {
+            return ancestor <= descendant && descendant < ends[ancestor];
+        }
+
+        [[nodiscard]] auto get_byte_range(node_position position) const -> extent<uint32_t>
+        {
+            return node{nodes[position]}.get_byte_range();
+        }
+
+    private:
+        static constexpr uint8_t named_flag = 1;
+        static constexpr uint8_t extra_flag = 2;
+        static constexpr uint8_t missing_flag = 4;
+
+        std::vector<TSNode> nodes;
+        std::vector<symbol> symbols;
+        std::vector<field_id> fields;
+        std::vector<uint8_t> flags;
+        std::vector<node_position> parents;
+        std::vector<node_position> ends;
+        std::vector<uint32_t> depths;
+    };
+
+}
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef CPP_TREE_SITTER_FOLDING_H
+#define CPP_TREE_SITTER_FOLDING_H
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+#include "tree_sitter/bundled.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+
+// Folding ranges for a whole document in one preorder walk. Every named node
+// spanning several lines folds at its first line; of several starting on the
+// same line the outermost is kept. Runs of comments on consecutive lines and
+// runs of adjacent imports fold as one range each. Ranges are in whole lines,
+// and a closing bracket on the last line is left visible.
+
+namespace ts
+{
+
+    // LSP's FoldingRangeKind.
+    enum class folding_kind : uint8_t
+    {
+        region,
+        comment,
+        imports,
+    };
+
+    struct folding_range
+    {
+        uint32_t start_line;
+        uint32_t end_line;
+        folding_kind kind;
+    };
+
+    class folding_builder
+    {
+    public:
+        explicit folding_builder(language language)
+            : roles(language.get_num_symbols(), role::other)
+        {
+            for (symbol id = 0; id < roles.size(); ++id)
+            {
+                if (language.get_symbol_type(id) != TSSymbolTypeRegular)
+                {
+                    continue;
+                }
+                std::string_view name = language.get_symbol_name(id);
+                if (is_comment_symbol(language, id))
+                {
+                    roles[id] = role::comment;
+                }
+                else if (name.ends_with("import_statement") || name.ends_with("import_declaration") ||
+                         name == "import_from_statement" || name == "preproc_include" || name == "using_directive" ||
+                         name == "use_declaration")
+                {
+                    roles[id] = role::import;
+                }
+            }
+        }
+
+        // Replaces `ranges` with the folding ranges of `tree`, parsed from
+        // `source`, sorted by start line.
+        auto fold(const tree &tree, std::string_view source, std::vector<folding_range> &ranges) const -> void
+        {
+            ranges.clear();
+            struct run
+            {
+                role kind = role::other;
+                uint32_t start_line = 0;
+                uint32_t end_line = 0;
+            } current;
+            auto flush = [&]()
+            {
+                if (current.kind != role::other && current.end_line > current.start_line)
+                {
+                    ranges.push_back({current.start_line,
+                                      current.end_line,
+                                      current.kind == role::comment ? folding_kind::comment : folding_kind::imports});
+                }
+                current.kind = role::other;
+            };
+
+            node root = tree.get_root_node();
+            visit(root,
+                  [&](node node) -> bool
+                  {
+                      symbol id = node.get_symbol();
+                      role kind = id < roles.size() ? roles[id] : role::other;
+                      extent<point> points = node.get_point_range();
+                      if (kind != role::other)
+                      {
+                          bool continues = kind == current.kind &&
+                                           (kind == role::import || points.start.row <= current.end_line + 1);
+                          if (!continues)
+                          {
+                              flush();
+                              current = {kind, points.start.row, points.end.row};
+                          }
+                          current.end_line = std::max(current.end_line, points.end.row);
+                          return false;
+                      }
+
+                      flush();
+                      if (!node.is_named() || points.end.row <= points.start.row || node.get_num_children() == 0 ||
+                          node.get_id() == root.get_id())
+                      {
+                          return true;
+                      }
+                      uint32_t end = node.get_byte_range().end;
+                      char last = end > 0 && end <= source.size() ? source[end - 1] : '\0';
+                      uint32_t end_line = points.end.row;
+                      if (last == ')' || last == ']' || last == '}')
+                      {
+                          end_line -= 1;
+                      }
+                      if (end_line > points.start.row)
+                      {
+                          ranges.push_back({points.start.row, end_line, folding_kind::region});
+                      }
+                      return true;
+                  });
+            flush();
+
+            // Runs are added when they end, after ranges that start later.
+            std::stable_sort(ranges.begin(),
+                             ranges.end(),
+                             [](const folding_range &a, const folding_range &b)
+                             {
+                                 return a.start_line != b.start_line ? a.start_line < b.start_line
+                                                                     : a.end_line > b.end_line;
+                             });
+            auto duplicate = std::unique(ranges.begin(),
+                                         ranges.end(),
+                                         [](const folding_range &a, const folding_range &b)
+                                         { return a.start_line == b.start_line; });
+            ranges.erase(duplicate, ranges.end());
+        }
+
+        [[nodiscard]] auto fold(const tree &tree, std::string_view source) const -> std::vector<folding_range>
+        {
+            std::vector<folding_range> ranges;
+            fold(tree, source, ranges);
+            return ranges;
+        }
+
+    private:
+        enum class role : uint8_t
+        {
+            other,
+            comment,
+            import,
+        };
+
+        std::vector<role> roles;
+    };
+
+}
+
+#endif
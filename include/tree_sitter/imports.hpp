@@ -0,0 +1,240 @@
+#ifndef CPP_TREE_SITTER_IMPORTS_H
+#define CPP_TREE_SITTER_IMPORTS_H
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tree_sitter/batch.hpp"
+#include "tree_sitter/bundled.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/text_predicates.hpp"
+
+// Import and dependency extraction: `#include` for C/C++, `import` for Go,
+// Java, Python, JavaScript and TypeScript (including `require` and dynamic
+// `import()`), and `use`/`mod`/`extern crate` for Rust.
+
+namespace ts
+{
+
+    enum class import_kind : uint8_t
+    {
+        // `#include "..."`
+        include,
+        // `#include <...>`
+        system_include,
+        import,
+        // A Rust `mod name;` declaration referring to another file.
+        module,
+    };
+
+    struct import_record
+    {
+        // The imported name with quotes or angle brackets removed.
+        std::string specifier;
+        import_kind kind;
+        extent<uint32_t> bytes;
+    };
+
+    [[nodiscard]] inline auto get_import_query(bundled_language language) -> std::string_view
+    {
+        switch (language)
+        {
+        case bundled_language::c:
+        case bundled_language::cpp:
+            return R"((preproc_include path: (string_literal) @include)
+(preproc_include path: (system_lib_string) @system_include))";
+        case bundled_language::go:
+            return R"((import_spec path: (_) @import))";
+        case bundled_language::java:
+            return R"((import_declaration [(identifier) (scoped_identifier)] @import))";
+        case bundled_language::python:
+            return R"((import_statement name: (dotted_name) @import)
+(import_statement name: (aliased_import name: (dotted_name) @import))
+(import_from_statement module_name: [(dotted_name) (relative_import)] @import))";
+        case bundled_language::javascript:
+        case bundled_language::typescript:
+        case bundled_language::tsx:
+            return R"((import_statement source: (string) @import)
+(export_statement source: (string) @import)
+(call_expression function: (import) arguments: (arguments . (string) @import))
+((call_expression function: (identifier) @_require arguments: (arguments . (string) @import))
+ (#eq? @_require "require")))";
+        case bundled_language::rust:
+            return R"((use_declaration argument: (_) @import)
+(extern_crate_declaration name: (identifier) @import)
+(mod_item name: (identifier) @module !body))";
+        case bundled_language::json:
+            return {};
+        case bundled_language::c_sharp:
+            return R"((using_directive [(identifier) (qualified_name)] @import))";
+        }
+        return {};
+    }
+
+    class import_extractor
+    {
+    public:
+        // Throws query_error if the bundled query does not match the grammar.
+        explicit import_extractor(bundled_language language)
+            : imports{get_language(language), get_import_query(language)},
+              import_predicates{imports}
+        {
+            for (uint32_t id = 0; id < imports.get_num_captures(); ++id)
+            {
+                std::string_view name = imports.get_capture_name(id);
+                if (name == "include")
+                {
+                    kinds.push_back(import_kind::include);
+                }
+                else if (name == "system_include")
+                {
+                    kinds.push_back(import_kind::system_include);
+                }
+                else if (name == "module")
+                {
+                    kinds.push_back(import_kind::module);
+                }
+                else
+                {
+                    kinds.push_back(import_kind::import);
+                }
+                is_result.push_back(!name.starts_with('_'));
+            }
+        }
+
+        auto extract(const tree &tree,
+                     std::string_view source,
+                     query_cursor &cursor,
+                     std::vector<import_record> &records) const -> void
+        {
+            cursor.exec(imports, tree.get_root_node());
+            query_match match;
+            while (cursor.next_match(match))
+            {
+                if (!import_predicates.satisfies(match, source))
+                {
+                    continue;
+                }
+                for (uint32_t i = 0; i < match.get_num_captures(); ++i)
+                {
+                    uint32_t id = match.get_capture_id(i);
+                    if (!is_result[id])
+                    {
+                        continue;
+                    }
+                    node node = match.get_capture_node(i);
+                    records.push_back({std::string{unquote(node.get_source_range(source))},
+                                       kinds[id],
+                                       node.get_byte_range()});
+                }
+            }
+        }
+
+        [[nodiscard]] auto extract(const tree &tree, std::string_view source) const -> std::vector<import_record>
+        {
+            std::vector<import_record> records;
+            query_cursor cursor;
+            extract(tree, source, cursor, records);
+            return records;
+        }
+
+    private:
+        [[nodiscard]] static auto unquote(std::string_view text) -> std::string_view
+        {
+            if (text.size() >= 2 && (text.front() == '"' || text.front() == '\'' || text.front() == '`' ||
+                                     text.front() == '<'))
+            {
+                return text.substr(1, text.size() - 2);
+            }
+            return text;
+        }
+
+        query imports;
+        text_predicates import_predicates;
+        std::vector<import_kind> kinds;
+        std::vector<bool> is_result;
+    };
+
+    using dependency_source = source_file;
+
+    struct dependency_edge
+    {
+        // Index of the importing file.
+        uint32_t from;
+        std::string specifier;
+        // For quoted includes and `./`-style relative imports, the imported
+        // path resolved lexically against the importing file; otherwise empty.
+        std::string resolved;
+        import_kind kind;
+    };
+
+    // Resolves relative specifiers against the directory of `importer` without
+    // touching the file system.
+    [[nodiscard]] inline auto resolve_import(std::string_view importer, const import_record &record) -> std::string
+    {
+        std::string_view specifier = record.specifier;
+        bool relative = record.kind == import_kind::include || specifier.starts_with("./") ||
+                        specifier.starts_with("../");
+        if (!relative || specifier.empty())
+        {
+            return {};
+        }
+        std::filesystem::path base = std::filesystem::path{importer}.parent_path();
+        return (base / specifier).lexically_normal().generic_string();
+    }
+
+    // Builds the repository-wide edge list. Files are parsed and queried in
+    // parallel; edges are ordered by importing file.
+    [[nodiscard]] inline auto extract_dependencies(std::span<const dependency_source> files, unsigned threads = 0)
+        -> std::vector<dependency_edge>
+    {
+        std::array<std::unique_ptr<import_extractor>, std::size(bundled_languages)> extractors;
+        for (const dependency_source &file : files)
+        {
+            auto &slot = extractors[static_cast<size_t>(file.language)];
+            if (!slot)
+            {
+                slot = std::make_unique<import_extractor>(file.language);
+            }
+        }
+
+        unsigned num_workers = get_worker_count(files.size(), threads);
+        parser_pool parsers{num_workers};
+        std::vector<query_cursor> cursors(num_workers);
+        std::vector<std::vector<dependency_edge>> results(files.size());
+
+        parallel_for(
+            files.size(),
+            [&](size_t index, unsigned worker)
+            {
+                const dependency_source &file = files[index];
+                tree tree = parsers.get(worker, get_language(file.language)).parse_string(file.text);
+                std::vector<import_record> records;
+                extractors[static_cast<size_t>(file.language)]->extract(tree, file.text, cursors[worker], records);
+                for (import_record &record : records)
+                {
+                    std::string resolved = resolve_import(file.path, record);
+                    results[index].push_back(
+                        {static_cast<uint32_t>(index), std::move(record.specifier), std::move(resolved), record.kind});
+                }
+            },
+            num_workers);
+
+        std::vector<dependency_edge> edges;
+        for (std::vector<dependency_edge> &result : results)
+        {
+            std::move(result.begin(), result.end(), std::back_inserter(edges));
+        }
+        return edges;
+    }
+
+}
+
+#endif
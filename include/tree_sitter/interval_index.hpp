@@ -0,0 +1,247 @@
+#ifndef CPP_TREE_SITTER_INTERVAL_INDEX_H
+#define CPP_TREE_SITTER_INTERVAL_INDEX_H
+
+#include <algorithm>
+#include <numeric>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/flat_tree.hpp"
+
+// Maps byte or point ranges, such as compiler diagnostics, to the nodes of a
+// flat_tree. Node ranges are nested, so they are kept as sorted preorder
+// arrays with parent links: a single lookup is a binary search plus a short
+// climb, and a batch of lookups is one sweep over the nodes in start order
+// that keeps the chain of open ancestors on a stack.
+
+namespace ts
+{
+
+    class interval_index
+    {
+    public:
+        interval_index() = default;
+
+        // Indexes the named nodes of `tree`, or all of them if `named_only` is
+        // false.
+        explicit interval_index(const flat_tree &tree, bool named_only = true)
+        {
+            assign(tree, named_only);
+        }
+
+        auto assign(const flat_tree &tree, bool named_only = true) -> void
+        {
+            positions.clear();
+            bytes.clear();
+            points.clear();
+            parents.clear();
+
+            constexpr uint32_t none = no_position;
+            std::vector<uint32_t> entries(tree.size(), none);
+            for (node_position position = 0; position < tree.size(); ++position)
+            {
+                if (named_only && !tree.is_named(position))
+                {
+                    continue;
+                }
+                node_position ancestor = tree.get_parent(position);
+                while (ancestor != no_position && entries[ancestor] == none)
+                {
+                    ancestor = tree.get_parent(ancestor);
+                }
+
+                entries[position] = static_cast<uint32_t>(positions.size());
+                positions.push_back(position);
+                node node = tree.get_node(position);
+                bytes.push_back(node.get_byte_range());
+                points.push_back(node.get_point_range());
+                parents.push_back(ancestor == no_position ? none : entries[ancestor]);
+            }
+        }
+
+        [[nodiscard]] auto size() const -> size_t
+        {
+            return positions.size();
+        }
+
+        // Returns the innermost indexed node whose range contains `range`, or
+        // no_position. Of two nodes touching at an empty range, the one
+        // starting there wins.
+        [[nodiscard]] auto find_enclosing(extent<uint32_t> range) const -> node_position
+        {
+            return find_enclosing_impl(range);
+        }
+
+        [[nodiscard]] auto find_enclosing(extent<point> range) const -> node_position
+        {
+            return find_enclosing_impl(range);
+        }
+
+        // Batched find_enclosing: sorts the queries by start and answers all
+        // of them in one sweep. `results` must be as long as `ranges`.
+        auto find_enclosing(std::span<const extent<uint32_t>> ranges, std::span<node_position> results) const -> void
+        {
+            find_enclosing_impl(ranges, results);
+        }
+
+        auto find_enclosing(std::span<const extent<point>> ranges, std::span<node_position> results) const -> void
+        {
+            find_enclosing_impl(ranges, results);
+        }
+
+        // Calls fn(position) in document order for every indexed node
+        // overlapping `range`. An empty range overlaps the nodes that contain
+        // it, excluding those ending at it.
+        template <typename Fn>
+        auto for_each_overlapping(extent<uint32_t> range, Fn &&fn) const -> void
+        {
+            for_each_overlapping_impl(range, fn);
+        }
+
+        template <typename Fn>
+        auto for_each_overlapping(extent<point> range, Fn &&fn) const -> void
+        {
+            for_each_overlapping_impl(range, fn);
+        }
+
+        // Calls fn(query, position) for each query in `ranges` and each node
+        // overlapping it.
+        template <typename Range, typename Fn>
+        auto for_each_overlapping(std::span<const Range> ranges, Fn &&fn) const -> void
+        {
+            for (size_t query = 0; query < ranges.size(); ++query)
+            {
+                for_each_overlapping_impl(ranges[query], [&](node_position position) { fn(query, position); });
+            }
+        }
+
+    private:
+        [[nodiscard]] static auto less(uint32_t a, uint32_t b) -> bool
+        {
+            return a < b;
+        }
+
+        [[nodiscard]] static auto less(point a, point b) -> bool
+        {
+            return a.row < b.row || (a.row == b.row && a.column < b.column);
+        }
+
+        template <typename Key>
+        [[nodiscard]] auto get_range(uint32_t entry) const -> extent<Key>
+        {
+            if constexpr (std::is_same_v<Key, point>)
+            {
+                return points[entry];
+            }
+            else
+            {
+                return bytes[entry];
+            }
+        }
+
+        // The last entry starting at or before `start`, or no_position.
+        template <typename Key>
+        [[nodiscard]] auto find_last_starting(Key start) const -> uint32_t
+        {
+            uint32_t low = 0;
+            auto high = static_cast<uint32_t>(positions.size());
+            while (low < high)
+            {
+                uint32_t middle = low + (high - low) / 2;
+                if (less(start, get_range<Key>(middle).start))
+                {
+                    high = middle;
+                }
+                else
+                {
+                    low = middle + 1;
+                }
+            }
+            return low == 0 ? no_position : low - 1;
+        }
+
+        template <typename Key>
+        [[nodiscard]] auto find_enclosing_impl(extent<Key> range) const -> node_position
+        {
+            // Every node containing the range is the last node starting
+            // before it or one of that node's ancestors.
+            uint32_t entry = find_last_starting(range.start);
+            while (entry != no_position && less(get_range<Key>(entry).end, range.end))
+            {
+                entry = parents[entry];
+            }
+            return entry == no_position ? no_position : positions[entry];
+        }
+
+        template <typename Key>
+        auto find_enclosing_impl(std::span<const extent<Key>> ranges, std::span<node_position> results) const -> void
+        {
+            std::vector<uint32_t> order(ranges.size());
+            std::iota(order.begin(), order.end(), 0u);
+            std::sort(order.begin(),
+                      order.end(),
+                      [&](uint32_t a, uint32_t b) { return less(ranges[a].start, ranges[b].start); });
+
+            // The ancestor chain of the last node entered; its ends never
+            // increase from bottom to top.
+            std::vector<uint32_t> stack;
+            uint32_t next = 0;
+            for (uint32_t query : order)
+            {
+                extent<Key> range = ranges[query];
+                while (next < positions.size() && !less(range.start, get_range<Key>(next).start))
+                {
+                    while (!stack.empty() && stack.back() != parents[next])
+                    {
+                        stack.pop_back();
+                    }
+                    stack.push_back(next++);
+                }
+                auto open = std::partition_point(stack.begin(),
+                                                 stack.end(),
+                                                 [&](uint32_t entry)
+                                                 { return !less(get_range<Key>(entry).end, range.end); });
+                results[query] = open == stack.begin() ? no_position : positions[*(open - 1)];
+            }
+        }
+
+        template <typename Key, typename Fn>
+        auto for_each_overlapping_impl(extent<Key> range, Fn &&fn) const -> void
+        {
+            // Nodes starting at or before the range overlap it if they
+            // continue past its start; they are ancestors of the last such
+            // node, or that node itself.
+            uint32_t last = find_last_starting(range.start);
+            std::vector<uint32_t> chain;
+            for (uint32_t entry = last; entry != no_position; entry = parents[entry])
+            {
+                if (less(range.start, get_range<Key>(entry).end))
+                {
+                    chain.push_back(entry);
+                }
+            }
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+            {
+                fn(positions[*it]);
+            }
+            // Nodes starting inside the range all overlap it.
+            for (uint32_t entry = last == no_position ? 0 : last + 1;
+                 entry < positions.size() && less(get_range<Key>(entry).start, range.end);
+                 ++entry)
+            {
+                fn(positions[entry]);
+            }
+        }
+
+        std::vector<node_position> positions;
+        std::vector<extent<uint32_t>> bytes;
+        std::vector<extent<point>> points;
+        // Entry of the nearest indexed ancestor, or no_position.
+        std::vector<uint32_t> parents;
+    };
+
+}
+
+#endif
@@ -0,0 +1,450 @@
+#ifndef CPP_TREE_SITTER_JSON_H
+#define CPP_TREE_SITTER_JSON_H
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tree_sitter/cpp-tree-sitter.hpp"
+
+// Decodes a tree from the JSON grammar into a tape: one flat array of entries
+// in document order, with numbers parsed and string escapes resolved. Every
+// entry keeps its source range so callers can report errors against the input.
+
+namespace ts
+{
+
+    enum class json_kind : uint8_t
+    {
+        null,
+        boolean,
+        number,
+        string,
+        array,
+        object,
+    };
+
+    inline constexpr uint32_t no_json_entry = std::numeric_limits<uint32_t>::max();
+
+    struct json_entry
+    {
+        json_kind kind;
+        // Booleans: 0 or 1. Strings: decoded length. Arrays: number of
+        // elements. Objects: number of members.
+        uint32_t size;
+        // Numbers: index into json_tape::numbers. Strings: offset into
+        // json_tape::strings. Arrays and objects: the entry following the
+        // last one that belongs to the value.
+        uint32_t payload;
+        extent<uint32_t> bytes;
+        point start;
+    };
+
+    struct json_error
+    {
+        std::string message;
+        extent<uint32_t> bytes;
+        point start;
+    };
+
+    // An array entry is followed by its elements and an object entry by a key
+    // string and a value for each member, so skipping over any value is a
+    // single jump. A document holding several top-level values stores them
+    // one after another starting at entry 0.
+    struct json_tape
+    {
+        std::vector<json_entry> entries;
+        std::vector<double> numbers;
+        std::string strings;
+        std::vector<json_error> errors;
+
+        [[nodiscard]] auto get_kind(uint32_t entry) const -> json_kind
+        {
+            return entries[entry].kind;
+        }
+
+        [[nodiscard]] auto get_bool(uint32_t entry) const -> bool
+        {
+            return entries[entry].size != 0;
+        }
+
+        [[nodiscard]] auto get_number(uint32_t entry) const -> double
+        {
+            return numbers[entries[entry].payload];
+        }
+
+        [[nodiscard]] auto get_string(uint32_t entry) const -> std::string_view
+        {
+            return std::string_view{strings}.substr(entries[entry].payload, entries[entry].size);
+        }
+
+        [[nodiscard]] auto get_size(uint32_t entry) const -> uint32_t
+        {
+            return entries[entry].size;
+        }
+
+        // Returns the entry following the value at `entry` and all of its
+        // descendants.
+        [[nodiscard]] auto get_next(uint32_t entry) const -> uint32_t
+        {
+            json_kind kind = entries[entry].kind;
+            return kind == json_kind::array || kind == json_kind::object ? entries[entry].payload : entry + 1;
+        }
+
+        // Returns element `position` of the array at `entry`, which must be
+        // less than its size. Linear in `position`.
+        [[nodiscard]] auto get_element(uint32_t entry, uint32_t position) const -> uint32_t
+        {
+            uint32_t element = entry + 1;
+            while (position-- > 0)
+            {
+                element = get_next(element);
+            }
+            return element;
+        }
+
+        // Returns the value of the last member named `key` in the object at
+        // `entry`, or no_json_entry. Linear in the number of members.
+        [[nodiscard]] auto find_member(uint32_t entry, std::string_view key) const -> uint32_t
+        {
+            uint32_t found = no_json_entry;
+            uint32_t member = entry + 1;
+            for (uint32_t i = 0; i < entries[entry].size; ++i)
+            {
+                if (get_string(member) == key)
+                {
+                    found = member + 1;
+                }
+                member = get_next(member + 1);
+            }
+            return found;
+        }
+    };
+
+    class json_decoder
+    {
+    public:
+        explicit json_decoder(language language = tree_sitter_json())
+            : document_symbol{language.get_symbol_for_name("document", true)},
+              object_symbol{language.get_symbol_for_name("object", true)},
+              pair_symbol{language.get_symbol_for_name("pair", true)},
+              array_symbol{language.get_symbol_for_name("array", true)},
+              string_symbol{language.get_symbol_for_name("string", true)},
+              number_symbol{language.get_symbol_for_name("number", true)},
+              true_symbol{language.get_symbol_for_name("true", true)},
+              false_symbol{language.get_symbol_for_name("false", true)},
+              null_symbol{language.get_symbol_for_name("null", true)}
+        {
+        }
+
+        // Decodes `tree`, parsed from `source`, into `tape`. Syntax errors,
+        // invalid escapes and out-of-range numbers are recorded in
+        // tape.errors; whatever could be recovered is still decoded, with a
+        // member missing its value given null.
+        auto decode(const tree &tree, std::string_view source, json_tape &tape) const -> void
+        {
+            tape.entries.clear();
+            tape.numbers.clear();
+            tape.strings.clear();
+            tape.errors.clear();
+
+            struct frame
+            {
+                symbol kind;
+                // Arrays and objects: their entry. Pairs: values seen so far.
+                uint32_t value;
+            };
+            std::vector<frame> frames;
+
+            auto report = [&](node node, std::string message)
+            {
+                tape.errors.push_back({std::move(message), node.get_byte_range(), node.get_point_range().start});
+            };
+            auto add = [&](node node, json_kind kind, uint32_t size, uint32_t payload) -> uint32_t
+            {
+                tape.entries.push_back({kind, size, payload, node.get_byte_range(), node.get_point_range().start});
+                return static_cast<uint32_t>(tape.entries.size() - 1);
+            };
+            auto add_string = [&](node node, std::string_view text, bool quoted)
+            {
+                auto offset = static_cast<uint32_t>(tape.strings.size());
+                if (quoted)
+                {
+                    if (text.size() < 2 || text.back() != '"' || node.has_error())
+                    {
+                        report(node, "unterminated string");
+                    }
+                    text = text.substr(1, text.size() >= 2 && text.back() == '"' ? text.size() - 2 : text.size() - 1);
+                    if (!unescape(text, tape.strings))
+                    {
+                        report(node, "invalid escape sequence");
+                    }
+                }
+                else
+                {
+                    tape.strings.append(text);
+                }
+                add(node, json_kind::string, static_cast<uint32_t>(tape.strings.size()) - offset, offset);
+            };
+
+            // Returns whether to descend into the node.
+            auto enter = [&](node node) -> bool
+            {
+                if (node.is_missing())
+                {
+                    report(node, "missing " + std::string{node.get_type()});
+                    return false;
+                }
+                if (node.is_extra() || !node.is_named())
+                {
+                    return false;
+                }
+
+                symbol id = node.get_symbol();
+                if (id == document_symbol || id == pair_symbol)
+                {
+                    frames.push_back({id, 0});
+                    return true;
+                }
+                bool is_value = id == object_symbol || id == array_symbol || id == string_symbol ||
+                                id == number_symbol || id == true_symbol || id == false_symbol || id == null_symbol;
+                if (!is_value || frames.empty())
+                {
+                    report(node, node.is_error() ? "unexpected input" : "unexpected " + std::string{node.get_type()});
+                    return false;
+                }
+
+                frame &parent = frames.back();
+                if (parent.kind == pair_symbol)
+                {
+                    if (parent.value == 0)
+                    {
+                        // Keys are stored as strings whatever was written.
+                        if (id != string_symbol)
+                        {
+                            report(node, "object key is not a string");
+                        }
+                        add_string(node, node.get_source_range(source), id == string_symbol);
+                        parent.value = 1;
+                        return false;
+                    }
+                    if (parent.value == 2)
+                    {
+                        report(node, "unexpected value");
+                        return false;
+                    }
+                    parent.value = 2;
+                }
+                else if (parent.kind == array_symbol)
+                {
+                    ++tape.entries[parent.value].size;
+                }
+
+                if (id == object_symbol || id == array_symbol)
+                {
+                    uint32_t entry = add(node, id == object_symbol ? json_kind::object : json_kind::array, 0, 0);
+                    frames.push_back({id, entry});
+                    return true;
+                }
+                if (id == string_symbol)
+                {
+                    add_string(node, node.get_source_range(source), true);
+                }
+                else if (id == number_symbol)
+                {
+                    std::string_view text = node.get_source_range(source);
+                    double number = 0;
+                    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+                    if (error != std::errc{} || end != text.data() + text.size())
+                    {
+                        report(node, "invalid number");
+                    }
+                    add(node, json_kind::number, 0, static_cast<uint32_t>(tape.numbers.size()));
+                    tape.numbers.push_back(number);
+                }
+                else if (id == null_symbol)
+                {
+                    add(node, json_kind::null, 0, 0);
+                }
+                else
+                {
+                    add(node, json_kind::boolean, id == true_symbol, 0);
+                }
+                return false;
+            };
+
+            // Called after the children of every node that enter descended into.
+            auto leave = [&](node node)
+            {
+                frame closed = frames.back();
+                frames.pop_back();
+                if (closed.kind == object_symbol || closed.kind == array_symbol)
+                {
+                    tape.entries[closed.value].payload = static_cast<uint32_t>(tape.entries.size());
+                }
+                else if (closed.kind == pair_symbol && closed.value != 0)
+                {
+                    if (closed.value == 1)
+                    {
+                        report(node, "missing value");
+                        add(node, json_kind::null, 0, 0);
+                    }
+                    if (!frames.empty() && frames.back().kind == object_symbol)
+                    {
+                        ++tape.entries[frames.back().value].size;
+                    }
+                }
+            };
+
+            cursor cursor{tree.get_root_node().impl};
+            for (;;)
+            {
+                if (enter(cursor.get_current_node()))
+                {
+                    if (cursor.goto_first_child())
+                    {
+                        continue;
+                    }
+                    leave(cursor.get_current_node());
+                }
+                while (!cursor.goto_next_sibling())
+                {
+                    if (!cursor.goto_parent())
+                    {
+                        return;
+                    }
+                    leave(cursor.get_current_node());
+                }
+            }
+        }
+
+        [[nodiscard]] auto decode(const tree &tree, std::string_view source) const -> json_tape
+        {
+            json_tape tape;
+            decode(tree, source, tape);
+            return tape;
+        }
+
+    private:
+        // Appends the unquoted string body `text` to `out` with escapes
+        // resolved; returns false if any escape was invalid, which is copied
+        // through verbatim.
+        [[nodiscard]] static auto unescape(std::string_view text, std::string &out) -> bool
+        {
+            bool valid = true;
+            for (size_t i = 0;;)
+            {
+                size_t escape = text.find('\\', i);
+                out.append(text.substr(i, escape - i));
+                if (escape == std::string_view::npos)
+                {
+                    return valid;
+                }
+
+                i = escape + 2;
+                char c = escape + 1 < text.size() ? text[escape + 1] : '\0';
+                switch (c)
+                {
+                case '"':
+                case '\\':
+                case '/':
+                    out.push_back(c);
+                    continue;
+                case 'b':
+                    out.push_back('\b');
+                    continue;
+                case 'f':
+                    out.push_back('\f');
+                    continue;
+                case 'n':
+                    out.push_back('\n');
+                    continue;
+                case 'r':
+                    out.push_back('\r');
+                    continue;
+                case 't':
+                    out.push_back('\t');
+                    continue;
+                case 'u':
+                    if (uint32_t code = parse_hex(text, i); code != no_code)
+                    {
+                        i += 4;
+                        // Combine a surrogate pair into one code point.
+                        if (code >= 0xD800 && code < 0xDC00 && text.substr(i, 2) == "\\u")
+                        {
+                            uint32_t low = parse_hex(text, i + 2);
+                            if (low >= 0xDC00 && low < 0xE000)
+                            {
+                                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                                i += 6;
+                            }
+                        }
+                        append_utf8(code, out);
+                        continue;
+                    }
+                    break;
+                default:
+                    break;
+                }
+                valid = false;
+                i = std::min(escape + 2, text.size());
+                out.append(text.substr(escape, i - escape));
+            }
+        }
+
+        static constexpr uint32_t no_code = std::numeric_limits<uint32_t>::max();
+
+        [[nodiscard]] static auto parse_hex(std::string_view text, size_t at) -> uint32_t
+        {
+            if (at + 4 > text.size())
+            {
+                return no_code;
+            }
+            uint32_t code = 0;
+            auto [end, error] = std::from_chars(text.data() + at, text.data() + at + 4, code, 16);
+            return error == std::errc{} && end == text.data() + at + 4 ? code : no_code;
+        }
+
+        static auto append_utf8(uint32_t code, std::string &out) -> void
+        {
+            if (code < 0x80)
+            {
+                out.push_back(static_cast<char>(code));
+            }
+            else if (code < 0x800)
+            {
+                out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+                out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+            }
+            else if (code < 0x10000)
+            {
+                out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+                out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+            }
+            else
+            {
+                out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+                out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+            }
+        }
+
+        symbol document_symbol;
+        symbol object_symbol;
+        symbol pair_symbol;
+        symbol array_symbol;
+        symbol string_symbol;
+        symbol number_symbol;
+        symbol true_symbol;
+        symbol false_symbol;
+        symbol null_symbol;
+    };
+
+}
+
+#endif
@@ -15,6 +15,7 @@ const TSLanguage *tree_sitter_c_sharp();
 const TSLanguage *tree_sitter_go();
 const TSLanguage *tree_sitter_java();
 const TSLanguage *tree_sitter_javascript();
+const TSLanguage *tree_sitter_json();
 const TSLanguage *tree_sitter_python();
 const TSLanguage *tree_sitter_rust();
 const TSLanguage *tree_sitter_typescript();
@@ -0,0 +1,875 @@
+#ifndef CPP_TREE_SITTER_LANGUAGE_SERVER_H
+#define CPP_TREE_SITTER_LANGUAGE_SERVER_H
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tree_sitter/bundled.hpp"
+#include "tree_sitter/codemod.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/folding.hpp"
+#include "tree_sitter/json.hpp"
+#include "tree_sitter/outline.hpp"
+#include "tree_sitter/selection.hpp"
+#include "tree_sitter/semantic_tokens.hpp"
+
+// The message handling of a small language server: JSON-RPC requests in, JSON
+// responses out, with the transport (stdio, sockets, framing) left to the
+// caller. Open documents are kept parsed; every change is applied as an edit
+// followed by an incremental reparse, after which the outline and semantic
+// tokens are updated for the changed ranges only. Folding and selection
+// ranges are computed on request in a single pass.
+//
+// Supported: initialize, shutdown, exit, textDocument/didOpen, didChange
+// (incremental or full), didClose, documentSymbol, foldingRange,
+// selectionRange, semanticTokens/full and semanticTokens/full/delta.
+// Requests are parsed with the bundled JSON grammar and json_decoder.
+
+namespace ts
+{
+
+    namespace detail
+    {
+        // Appends JSON to a string, inserting commas between values.
+        class json_writer
+        {
+        public:
+            explicit json_writer(std::string &out)
+                : out{out}
+            {
+            }
+
+            auto begin_object() -> void
+            {
+                separate();
+                out.push_back('{');
+                comma = false;
+            }
+
+            auto end_object() -> void
+            {
+                out.push_back('}');
+                comma = true;
+            }
+
+            auto begin_array() -> void
+            {
+                separate();
+                out.push_back('[');
+                comma = false;
+            }
+
+            auto end_array() -> void
+            {
+                out.push_back(']');
+                comma = true;
+            }
+
+            auto key(std::string_view name) -> void
+            {
+                string(name);
+                out.push_back(':');
+                comma = false;
+            }
+
+            auto string(std::string_view text) -> void
+            {
+                separate();
+                out.push_back('"');
+                for (char c : text)
+                {
+                    switch (c)
+                    {
+                    case '"':
+                        out.append("\\\"");
+                        break;
+                    case '\\':
+                        out.append("\\\\");
+                        break;
+                    case '\n':
+                        out.append("\\n");
+                        break;
+                    case '\r':
+                        out.append("\\r");
+                        break;
+                    case '\t':
+                        out.append("\\t");
+                        break;
+                    default:
+                        if (static_cast<unsigned char>(c) < 0x20)
+                        {
+                            static constexpr char digits[] = "0123456789abcdef";
+                            out.append("\\u00");
+                            out.push_back(digits[(c >> 4) & 0xF]);
+                            out.push_back(digits[c & 0xF]);
+                        }
+                        else
+                        {
+                            out.push_back(c);
+                        }
+                    }
+                }
+                out.push_back('"');
+                comma = true;
+            }
+
+            auto number(uint64_t value) -> void
+            {
+                separate();
+                char buffer[24];
+                auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+                out.append(buffer, result.ptr);
+                comma = true;
+            }
+
+            auto boolean(bool value) -> void
+            {
+                raw(value ? "true" : "false");
+            }
+
+            auto null() -> void
+            {
+                raw("null");
+            }
+
+            // Writes already encoded JSON as one value.
+            auto raw(std::string_view json) -> void
+            {
+                separate();
+                out.append(json);
+                comma = true;
+            }
+
+        private:
+            auto separate() -> void
+            {
+                if (comma)
+                {
+                    out.push_back(',');
+                }
+            }
+
+            std::string &out;
+            bool comma = false;
+        };
+    }
+
+    class language_server
+    {
+    public:
+        // `highlights[i]` is the highlights query for bundled_languages[i],
+        // or empty to serve no semantic tokens for it.
+        explicit language_server(std::array<std::string, std::size(bundled_languages)> highlights = {})
+            : highlights{std::move(highlights)}
+        {
+        }
+
+        // Handles one JSON-RPC message. Returns true and sets `response` if
+        // the message calls for one.
+        auto handle(std::string_view message, std::string &response) -> bool
+        {
+            response.clear();
+            tree parsed = json_parser.parse_string(message);
+            decoder.decode(parsed, message, request);
+            detail::json_writer writer{response};
+            if (!request.errors.empty() || request.entries.empty() || request.get_kind(0) != json_kind::object)
+            {
+                write_error(writer, "null", -32700, "parse error");
+                return true;
+            }
+
+            uint32_t method_entry = get_member(0, "method");
+            uint32_t id_entry = get_member(0, "id");
+            std::string_view method = get_text(method_entry);
+            uint32_t params = get_member(0, "params");
+            if (id_entry == no_json_entry)
+            {
+                notify(method, params);
+                return false;
+            }
+
+            extent<uint32_t> id_bytes = request.entries[id_entry].bytes;
+            std::string_view id = message.substr(id_bytes.start, id_bytes.end - id_bytes.start);
+            std::string result;
+            detail::json_writer result_writer{result};
+            int code = 0;
+            std::string error;
+            try
+            {
+                code = call(method, params, result_writer);
+                error = code == -32601 ? "method not found" : code == -32602 ? "invalid params" : "";
+            }
+            catch (const std::exception &failure)
+            {
+                code = -32603;
+                error = failure.what();
+            }
+
+            if (code != 0)
+            {
+                write_error(writer, id, code, error);
+                return true;
+            }
+            writer.begin_object();
+            writer.key("jsonrpc");
+            writer.string("2.0");
+            writer.key("id");
+            writer.raw(id);
+            writer.key("result");
+            writer.raw(result);
+            writer.end_object();
+            return true;
+        }
+
+        // Whether an exit notification was received.
+        [[nodiscard]] auto is_exiting() const -> bool
+        {
+            return exiting;
+        }
+
+        // The process exit code LSP asks for: 0 if shutdown came before exit.
+        [[nodiscard]] auto get_exit_code() const -> int
+        {
+            return shut_down ? 0 : 1;
+        }
+
+    private:
+        // Per-language state, created when the first document of the language
+        // is opened. Any feature whose query does not compile is left out.
+        struct services
+        {
+            services(bundled_language language, const std::string &highlights, position_encoding encoding)
+                : parsing{get_language(language)},
+                  folds{get_language(language)}
+            {
+                try
+                {
+                    outlines = std::make_unique<outline_builder>(language);
+                }
+                catch (const query_error &)
+                {
+                }
+                if (!highlights.empty())
+                {
+                    try
+                    {
+                        tokens = std::make_unique<semantic_tokenizer>(
+                            get_language(language), highlights, get_default_semantic_legend(), encoding);
+                    }
+                    catch (const query_error &)
+                    {
+                    }
+                }
+            }
+
+            ts::parser parsing;
+            folding_builder folds;
+            std::unique_ptr<outline_builder> outlines;
+            std::unique_ptr<semantic_tokenizer> tokens;
+            query_cursor cursor;
+        };
+
+        struct document
+        {
+            document(bundled_language language, std::string text, tree syntax)
+                : language{language},
+                  text{std::move(text)},
+                  syntax{std::move(syntax)}
+            {
+            }
+
+            bundled_language language;
+            std::string text;
+            // Byte offset of the start of every line.
+            std::vector<uint32_t> line_starts;
+            tree syntax;
+            document_outline outline;
+            std::vector<semantic_token> tokens;
+            // Encoding of `tokens`, and the encoding last sent with
+            // `result_id`.
+            std::vector<uint32_t> token_data;
+            std::vector<uint32_t> sent_data;
+            uint64_t result_id = 0;
+            // Edits to token_data since sent_data, the last one kept.
+            uint32_t num_edits = 0;
+            semantic_tokens_edit last_edit;
+        };
+
+        auto notify(std::string_view method, uint32_t params) -> void
+        {
+            if (method == "exit")
+            {
+                exiting = true;
+            }
+            else if (method == "textDocument/didOpen")
+            {
+                open(get_member(params, "textDocument"));
+            }
+            else if (method == "textDocument/didChange")
+            {
+                auto it = documents.find(std::string{get_text(get_member(get_member(params, "textDocument"), "uri"))});
+                uint32_t changes = get_member(params, "contentChanges");
+                if (it == documents.end() || changes == no_json_entry || request.get_kind(changes) != json_kind::array)
+                {
+                    return;
+                }
+                for (uint32_t i = 0, change = changes + 1; i < request.get_size(changes);
+                     ++i, change = request.get_next(change))
+                {
+                    apply_change(*it->second, change);
+                }
+            }
+            else if (method == "textDocument/didClose")
+            {
+                documents.erase(std::string{get_text(get_member(get_member(params, "textDocument"), "uri"))});
+            }
+        }
+
+        // Runs a request, writing its result. Returns 0 or a JSON-RPC error
+        // code.
+        auto call(std::string_view method, uint32_t params, detail::json_writer &writer) -> int
+        {
+            if (method == "initialize")
+            {
+                initialize(params, writer);
+                return 0;
+            }
+            if (method == "shutdown")
+            {
+                shut_down = true;
+                writer.null();
+                return 0;
+            }
+
+            auto it = documents.find(std::string{get_text(get_member(get_member(params, "textDocument"), "uri"))});
+            bool known = method == "textDocument/documentSymbol" || method == "textDocument/foldingRange" ||
+                         method == "textDocument/selectionRange" || method == "textDocument/semanticTokens/full" ||
+                         method == "textDocument/semanticTokens/full/delta";
+            if (!known)
+            {
+                return -32601;
+            }
+            if (it == documents.end())
+            {
+                return -32602;
+            }
+            document &document = *it->second;
+            services &services = get_services(document.language);
+
+            if (method == "textDocument/documentSymbol")
+            {
+                write_outline(writer, document);
+            }
+            else if (method == "textDocument/foldingRange")
+            {
+                write_folding_ranges(writer, document, services);
+            }
+            else if (method == "textDocument/selectionRange")
+            {
+                write_selection_ranges(writer, document, get_member(params, "positions"));
+            }
+            else if (method == "textDocument/semanticTokens/full")
+            {
+                write_tokens(writer, document);
+            }
+            else
+            {
+                write_token_delta(writer, document, get_text(get_member(params, "previousResultId")));
+            }
+            return 0;
+        }
+
+        auto initialize(uint32_t params, detail::json_writer &writer) -> void
+        {
+            uint32_t encodings =
+                get_member(get_member(get_member(params, "capabilities"), "general"), "positionEncodings");
+            if (encodings != no_json_entry && request.get_kind(encodings) == json_kind::array)
+            {
+                for (uint32_t i = 0, entry = encodings + 1; i < request.get_size(encodings);
+                     ++i, entry = request.get_next(entry))
+                {
+                    if (get_text(entry) == "utf-8")
+                    {
+                        encoding = position_encoding::utf8;
+                    }
+                }
+            }
+
+            semantic_legend legend = get_default_semantic_legend();
+            writer.begin_object();
+            writer.key("capabilities");
+            writer.begin_object();
+            writer.key("positionEncoding");
+            writer.string(encoding == position_encoding::utf8 ? "utf-8" : "utf-16");
+            writer.key("textDocumentSync");
+            writer.begin_object();
+            writer.key("openClose");
+            writer.boolean(true);
+            writer.key("change");
+            writer.number(2);
+            writer.end_object();
+            writer.key("documentSymbolProvider");
+            writer.boolean(true);
+            writer.key("foldingRangeProvider");
+            writer.boolean(true);
+            writer.key("selectionRangeProvider");
+            writer.boolean(true);
+            writer.key("semanticTokensProvider");
+            writer.begin_object();
+            writer.key("legend");
+            writer.begin_object();
+            writer.key("tokenTypes");
+            writer.begin_array();
+            for (const std::string &type : legend.token_types)
+            {
+                writer.string(type);
+            }
+            writer.end_array();
+            writer.key("tokenModifiers");
+            writer.begin_array();
+            for (const std::string &modifier : legend.token_modifiers)
+            {
+                writer.string(modifier);
+            }
+            writer.end_array();
+            writer.end_object();
+            writer.key("full");
+            writer.begin_object();
+            writer.key("delta");
+            writer.boolean(true);
+            writer.end_object();
+            writer.end_object();
+            writer.end_object();
+            writer.key("serverInfo");
+            writer.begin_object();
+            writer.key("name");
+            writer.string("cpp-tree-sitter");
+            writer.end_object();
+            writer.end_object();
+        }
+
+        auto open(uint32_t item) -> void
+        {
+            std::string_view uri = get_text(get_member(item, "uri"));
+            std::optional<bundled_language> language = get_language_for_id(get_text(get_member(item, "languageId")));
+            if (!language)
+            {
+                language = detect_language(uri);
+            }
+            if (!language)
+            {
+                return;
+            }
+
+            services &services = get_services(*language);
+            std::string text{get_text(get_member(item, "text"))};
+            tree syntax = services.parsing.parse_string(text);
+            auto entry = std::make_unique<document>(*language, std::move(text), std::move(syntax));
+            reanalyze(*entry, services);
+            documents.insert_or_assign(std::string{uri}, std::move(entry));
+        }
+
+        // Rebuilds everything after the text was replaced wholesale.
+        auto reanalyze(document &document, services &services) -> void
+        {
+            get_line_starts(document.text, document.line_starts);
+            if (services.outlines)
+            {
+                services.outlines->build(document.syntax, services.cursor, document.outline);
+            }
+            if (services.tokens)
+            {
+                services.tokens->tokenize(document.syntax, document.text, services.cursor, document.tokens);
+            }
+            document.token_data.clear();
+            encode_semantic_tokens(document.tokens, document.token_data);
+            // Forces the next delta to be diffed.
+            document.num_edits = 2;
+        }
+
+        auto apply_change(document &document, uint32_t change) -> void
+        {
+            services &services = get_services(document.language);
+            std::string_view text = get_text(get_member(change, "text"));
+            uint32_t range = get_member(change, "range");
+            if (range == no_json_entry)
+            {
+                document.text.assign(text);
+                document.syntax = services.parsing.parse_string(document.text);
+                reanalyze(document, services);
+                return;
+            }
+
+            uint32_t start = get_offset(document, get_member(range, "start"));
+            uint32_t end = std::max(start, get_offset(document, get_member(range, "end")));
+            point start_point = get_point(document, start);
+            TSInputEdit edit{start,
+                             end,
+                             start + static_cast<uint32_t>(text.size()),
+                             start_point,
+                             get_point(document, end),
+                             detail::advance(start_point, text)};
+            document.text.replace(start, end - start, text);
+            get_line_starts(document.text, document.line_starts);
+
+            document.syntax.edit(edit);
+            tree syntax = services.parsing.parse_string(document.syntax, document.text);
+            if (services.outlines)
+            {
+                services.outlines->update(document.outline, edit, document.syntax, syntax, services.cursor);
+            }
+            if (services.tokens)
+            {
+                semantic_tokens_edit tokens_edit = services.tokens->update(
+                    document.tokens, edit, document.syntax, syntax, document.text, services.cursor);
+                auto at = document.token_data.begin() + tokens_edit.start;
+                at = document.token_data.erase(at, at + tokens_edit.delete_count);
+                document.token_data.insert(at, tokens_edit.data.begin(), tokens_edit.data.end());
+                document.last_edit = std::move(tokens_edit);
+                ++document.num_edits;
+            }
+            document.syntax = std::move(syntax);
+        }
+
+        auto write_outline(detail::json_writer &writer, const document &document) const -> void
+        {
+            const std::vector<outline_entry> &entries = document.outline.entries;
+            std::vector<uint32_t> open_entries;
+            writer.begin_array();
+            for (uint32_t index = 0; index < entries.size(); ++index)
+            {
+                const outline_entry &entry = entries[index];
+                while (!open_entries.empty() && open_entries.back() != entry.parent)
+                {
+                    writer.end_array();
+                    writer.end_object();
+                    open_entries.pop_back();
+                }
+                std::string_view name = std::string_view{document.text}.substr(
+                    entry.name_bytes.start, entry.name_bytes.end - entry.name_bytes.start);
+                writer.begin_object();
+                writer.key("name");
+                writer.string(name.empty() ? "?" : name.substr(0, name.find('\n')));
+                writer.key("kind");
+                writer.number(static_cast<uint64_t>(entry.kind));
+                writer.key("range");
+                write_range(writer, document, entry.bytes);
+                writer.key("selectionRange");
+                write_range(writer, document, entry.name_bytes);
+                writer.key("children");
+                writer.begin_array();
+                open_entries.push_back(index);
+            }
+            for (size_t i = 0; i < open_entries.size(); ++i)
+            {
+                writer.end_array();
+                writer.end_object();
+            }
+            writer.end_array();
+        }
+
+        auto write_folding_ranges(detail::json_writer &writer, const document &document, services &services) const
+            -> void
+        {
+            static constexpr std::string_view kind_names[] = {"region", "comment", "imports"};
+            writer.begin_array();
+            for (const folding_range &range : services.folds.fold(document.syntax, document.text))
+            {
+                writer.begin_object();
+                writer.key("startLine");
+                writer.number(range.start_line);
+                writer.key("endLine");
+                writer.number(range.end_line);
+                writer.key("kind");
+                writer.string(kind_names[static_cast<size_t>(range.kind)]);
+                writer.end_object();
+            }
+            writer.end_array();
+        }
+
+        auto write_selection_ranges(detail::json_writer &writer, const document &document, uint32_t positions) const
+            -> void
+        {
+            std::vector<uint32_t> offsets;
+            if (positions != no_json_entry && request.get_kind(positions) == json_kind::array)
+            {
+                for (uint32_t i = 0, entry = positions + 1; i < request.get_size(positions);
+                     ++i, entry = request.get_next(entry))
+                {
+                    offsets.push_back(get_offset(document, entry));
+                }
+            }
+            selection_ranges chains = get_selection_ranges(document.syntax, offsets);
+
+            writer.begin_array();
+            for (size_t i = 0; i < offsets.size(); ++i)
+            {
+                uint32_t begin = chains.offsets[i];
+                uint32_t end = chains.offsets[i + 1];
+                for (uint32_t level = begin; level < end; ++level)
+                {
+                    if (level > begin)
+                    {
+                        writer.key("parent");
+                    }
+                    writer.begin_object();
+                    writer.key("range");
+                    write_range(writer, document, chains.ranges[level]);
+                }
+                for (uint32_t level = begin; level < end; ++level)
+                {
+                    writer.end_object();
+                }
+            }
+            writer.end_array();
+        }
+
+        auto write_tokens(detail::json_writer &writer, document &document) -> void
+        {
+            document.sent_data = document.token_data;
+            document.result_id = ++last_result_id;
+            document.num_edits = 0;
+            writer.begin_object();
+            writer.key("resultId");
+            writer.string(std::to_string(document.result_id));
+            writer.key("data");
+            write_numbers(writer, document.sent_data);
+            writer.end_object();
+        }
+
+        auto write_token_delta(detail::json_writer &writer, document &document, std::string_view previous) -> void
+        {
+            if (document.result_id == 0 || previous != std::to_string(document.result_id))
+            {
+                write_tokens(writer, document);
+                return;
+            }
+
+            semantic_tokens_edit edit;
+            if (document.num_edits == 1)
+            {
+                edit = std::move(document.last_edit);
+            }
+            else
+            {
+                // Several edits, or a full reparse, since the last result:
+                // send the differing middle of the two arrays.
+                const std::vector<uint32_t> &before = document.sent_data;
+                const std::vector<uint32_t> &after = document.token_data;
+                size_t prefix = std::mismatch(before.begin(), before.end(), after.begin(), after.end()).first -
+                                before.begin();
+                size_t suffix = 0;
+                while (suffix < before.size() - prefix && suffix < after.size() - prefix &&
+                       before[before.size() - 1 - suffix] == after[after.size() - 1 - suffix])
+                {
+                    ++suffix;
+                }
+                edit.start = static_cast<uint32_t>(prefix);
+                edit.delete_count = static_cast<uint32_t>(before.size() - prefix - suffix);
+                edit.data.assign(after.begin() + static_cast<std::ptrdiff_t>(prefix),
+                                 after.end() - static_cast<std::ptrdiff_t>(suffix));
+            }
+
+            document.sent_data = document.token_data;
+            document.result_id = ++last_result_id;
+            document.num_edits = 0;
+            writer.begin_object();
+            writer.key("resultId");
+            writer.string(std::to_string(document.result_id));
+            writer.key("edits");
+            writer.begin_array();
+            if (edit.delete_count > 0 || !edit.data.empty())
+            {
+                writer.begin_object();
+                writer.key("start");
+                writer.number(edit.start);
+                writer.key("deleteCount");
+                writer.number(edit.delete_count);
+                writer.key("data");
+                write_numbers(writer, edit.data);
+                writer.end_object();
+            }
+            writer.end_array();
+            writer.end_object();
+        }
+
+        static auto write_numbers(detail::json_writer &writer, const std::vector<uint32_t> &numbers) -> void
+        {
+            writer.begin_array();
+            for (uint32_t number : numbers)
+            {
+                writer.number(number);
+            }
+            writer.end_array();
+        }
+
+        auto write_range(detail::json_writer &writer, const document &document, extent<uint32_t> bytes) const -> void
+        {
+            writer.begin_object();
+            writer.key("start");
+            write_position(writer, document, bytes.start);
+            writer.key("end");
+            write_position(writer, document, bytes.end);
+            writer.end_object();
+        }
+
+        auto write_position(detail::json_writer &writer, const document &document, uint32_t byte) const -> void
+        {
+            point position = get_point(document, byte);
+            writer.begin_object();
+            writer.key("line");
+            writer.number(position.row);
+            writer.key("character");
+            writer.number(get_width(std::string_view{document.text}.substr(byte - position.column, position.column),
+                                    encoding));
+            writer.end_object();
+        }
+
+        static auto write_error(detail::json_writer &writer, std::string_view id, int code, std::string_view message)
+            -> void
+        {
+            writer.begin_object();
+            writer.key("jsonrpc");
+            writer.string("2.0");
+            writer.key("id");
+            writer.raw(id);
+            writer.key("error");
+            writer.begin_object();
+            writer.key("code");
+            writer.raw(std::to_string(code));
+            writer.key("message");
+            writer.string(message);
+            writer.end_object();
+            writer.end_object();
+        }
+
+        // Row and byte column of `byte`, as tree-sitter counts them.
+        [[nodiscard]] static auto get_point(const document &document, uint32_t byte) -> point
+        {
+            const std::vector<uint32_t> &starts = document.line_starts;
+            auto row = static_cast<uint32_t>(std::upper_bound(starts.begin(), starts.end(), byte) - starts.begin() - 1);
+            return {row, byte - starts[row]};
+        }
+
+        // Byte offset of an LSP position, clamped to its line.
+        [[nodiscard]] auto get_offset(const document &document, uint32_t position) const -> uint32_t
+        {
+            uint32_t line = get_number(get_member(position, "line"));
+            uint32_t character = get_number(get_member(position, "character"));
+            if (line >= document.line_starts.size())
+            {
+                return static_cast<uint32_t>(document.text.size());
+            }
+            uint32_t byte = document.line_starts[line];
+            uint32_t end = line + 1 < document.line_starts.size() ? document.line_starts[line + 1] - 1
+                                                                   : static_cast<uint32_t>(document.text.size());
+            for (uint32_t units = 0; byte < end && units < character;)
+            {
+                auto lead = static_cast<unsigned char>(document.text[byte]);
+                uint32_t length = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+                units += encoding == position_encoding::utf8 ? length : length == 4 ? 2 : 1;
+                byte = std::min(byte + length, end);
+            }
+            return byte;
+        }
+
+        static auto get_line_starts(std::string_view text, std::vector<uint32_t> &starts) -> void
+        {
+            starts.assign(1, 0);
+            for (size_t newline = text.find('\n'); newline != std::string_view::npos;
+                 newline = text.find('\n', newline + 1))
+            {
+                starts.push_back(static_cast<uint32_t>(newline + 1));
+            }
+        }
+
+        [[nodiscard]] static auto get_language_for_id(std::string_view id) -> std::optional<bundled_language>
+        {
+            static constexpr std::pair<std::string_view, bundled_language> ids[] = {
+                {"c", bundled_language::c},
+                {"cpp", bundled_language::cpp},
+                {"csharp", bundled_language::c_sharp},
+                {"go", bundled_language::go},
+                {"java", bundled_language::java},
+                {"javascript", bundled_language::javascript},
+                {"javascriptreact", bundled_language::javascript},
+                {"json", bundled_language::json},
+                {"jsonc", bundled_language::json},
+                {"python", bundled_language::python},
+                {"rust", bundled_language::rust},
+                {"typescript", bundled_language::typescript},
+                {"typescriptreact", bundled_language::tsx},
+            };
+            for (const auto &[name, language] : ids)
+            {
+                if (name == id)
+                {
+                    return language;
+                }
+            }
+            return std::nullopt;
+        }
+
+        auto get_services(bundled_language language) -> services &
+        {
+            auto &slot = languages[static_cast<size_t>(language)];
+            if (!slot)
+            {
+                slot = std::make_unique<services>(language, highlights[static_cast<size_t>(language)], encoding);
+            }
+            return *slot;
+        }
+
+        // Request accessors that tolerate missing or mistyped values.
+
+        [[nodiscard]] auto get_member(uint32_t entry, std::string_view key) const -> uint32_t
+        {
+            if (entry == no_json_entry || request.get_kind(entry) != json_kind::object)
+            {
+                return no_json_entry;
+            }
+            return request.find_member(entry, key);
+        }
+
+        [[nodiscard]] auto get_text(uint32_t entry) const -> std::string_view
+        {
+            return entry != no_json_entry && request.get_kind(entry) == json_kind::string ? request.get_string(entry)
+                                                                                          : std::string_view{};
+        }
+
+        [[nodiscard]] auto get_number(uint32_t entry) const -> uint32_t
+        {
+            if (entry == no_json_entry || request.get_kind(entry) != json_kind::number)
+            {
+                return 0;
+            }
+            double number = request.get_number(entry);
+            return number <= 0 ? 0 : number >= 4294967295.0 ? 4294967295u : static_cast<uint32_t>(number);
+        }
+
+        std::array<std::string, std::size(bundled_languages)> highlights;
+        std::array<std::unique_ptr<services>, std::size(bundled_languages)> languages;
+        std::unordered_map<std::string, std::unique_ptr<document>> documents;
+        position_encoding encoding = position_encoding::utf16;
+        uint64_t last_result_id = 0;
+        bool shut_down = false;
+        bool exiting = false;
+
+        ts::parser json_parser{tree_sitter_json()};
+        json_decoder decoder;
+        json_tape request;
+    };
+
+}
+
+#endif
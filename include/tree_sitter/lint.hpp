@@ -0,0 +1,237 @@
+#ifndef CPP_TREE_SITTER_LINT_H
+#define CPP_TREE_SITTER_LINT_H
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tree_sitter/batch.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/text_predicates.hpp"
+
+namespace ts
+{
+
+    struct lint_diagnostic
+    {
+        size_t rule;
+        std::string message;
+        extent<uint32_t> bytes;
+        extent<point> points;
+    };
+
+    // Handed to a rule callback for each match of that rule's query.
+    class lint_context
+    {
+    public:
+        lint_context(const query &query,
+                     std::span<const uint32_t> capture_ids,
+                     const query_match &match,
+                     std::string_view source,
+                     size_t rule,
+                     std::vector<lint_diagnostic> &diagnostics)
+            : fused{query},
+              capture_ids{capture_ids},
+              match{match},
+              source{source},
+              rule{rule},
+              diagnostics{diagnostics}
+        {
+        }
+
+        [[nodiscard]] auto get_match() const -> const query_match &
+        {
+            return match;
+        }
+
+        [[nodiscard]] auto get_source() const -> std::string_view
+        {
+            return source;
+        }
+
+        // Returns the node captured as the rule's `captures[index]` in this
+        // match, or a null node. The ids were resolved when the linter was
+        // built, so this only scans the match's own captures.
+        [[nodiscard]] auto find_capture(size_t index) const -> node
+        {
+            return match.find_capture(capture_ids[index]);
+        }
+
+        // Returns the node captured under `name` in this match, or a null node.
+        // Looks the name up in the fused query on every call; callbacks run
+        // per match should declare their captures and use find_capture().
+        [[nodiscard]] auto get_capture(std::string_view name) const -> node
+        {
+            std::optional<uint32_t> id = fused.get_capture_id(name);
+            return id ? match.find_capture(*id) : node{TSNode{}};
+        }
+
+        auto report(node node, std::string message) -> void
+        {
+            diagnostics.push_back({rule, std::move(message), node.get_byte_range(), node.get_point_range()});
+        }
+
+    private:
+        const query &fused;
+        std::span<const uint32_t> capture_ids;
+        const query_match &match;
+        std::string_view source;
+        size_t rule;
+        std::vector<lint_diagnostic> &diagnostics;
+    };
+
+    struct lint_rule
+    {
+        std::string name;
+        std::string query;
+        std::function<void(lint_context &)> callback;
+        // Captures the callback reads with lint_context::find_capture(index),
+        // by position in this list.
+        std::vector<std::string> captures;
+    };
+
+    // Fuses the queries of every rule for one language into a single query, so
+    // a file is matched in one pass no matter how many rules there are. Each
+    // pattern of the fused query is mapped back to the rule it came from.
+    class linter
+    {
+    public:
+        // Throws query_error naming the offending rule if any query is invalid
+        // or does not have one of the rule's declared captures; the error
+        // offset is relative to that rule's query.
+        linter(language language, std::vector<lint_rule> rules)
+            : lang{language},
+              rules{std::move(rules)},
+              fused{compile(language, this->rules, rule_offsets)},
+              fused_predicates{fused}
+        {
+            rule_for_pattern.reserve(fused.get_num_patterns());
+            for (uint32_t pattern = 0; pattern < fused.get_num_patterns(); ++pattern)
+            {
+                rule_for_pattern.push_back(find_rule(fused.get_pattern_start_byte(pattern)));
+            }
+
+            rule_captures.reserve(this->rules.size());
+            for (const lint_rule &rule : this->rules)
+            {
+                std::vector<uint32_t> &ids = rule_captures.emplace_back();
+                for (const std::string &name : rule.captures)
+                {
+                    std::optional<uint32_t> id = fused.get_capture_id(name);
+                    if (!id)
+                    {
+                        throw query_error{0,
+                                          TSQueryErrorCapture,
+                                          "unknown capture @" + name + " in lint rule '" + rule.name + "'"};
+                    }
+                    ids.push_back(*id);
+                }
+            }
+        }
+
+        [[nodiscard]] auto get_language() const -> language
+        {
+            return lang;
+        }
+
+        [[nodiscard]] auto get_num_rules() const -> size_t
+        {
+            return rules.size();
+        }
+
+        [[nodiscard]] auto get_rule(size_t rule) const -> const lint_rule &
+        {
+            return rules[rule];
+        }
+
+        auto run(const tree &tree, std::string_view source, query_cursor &cursor) const -> std::vector<lint_diagnostic>
+        {
+            std::vector<lint_diagnostic> diagnostics;
+            cursor.exec(fused, tree.get_root_node());
+            query_match match;
+            while (cursor.next_match(match))
+            {
+                if (!fused_predicates.satisfies(match, source))
+                {
+                    continue;
+                }
+                size_t rule = rule_for_pattern[match.get_pattern_index()];
+                lint_context context{fused, rule_captures[rule], match, source, rule, diagnostics};
+                rules[rule].callback(context);
+            }
+            return diagnostics;
+        }
+
+        auto run(const tree &tree, std::string_view source) const -> std::vector<lint_diagnostic>
+        {
+            query_cursor cursor;
+            return run(tree, source, cursor);
+        }
+
+        // Parses and lints every source in parallel. Results are indexed like
+        // `sources`. Callbacks may run concurrently on different files.
+        auto run_files(std::span<const std::string_view> sources, unsigned threads = 0) const
+            -> std::vector<std::vector<lint_diagnostic>>
+        {
+            std::vector<std::vector<lint_diagnostic>> results(sources.size());
+            std::vector<query_cursor> cursors(get_worker_count(sources.size(), threads));
+            parse_each(
+                lang,
+                sources,
+                [&](const tree &tree, std::string_view source, size_t index, unsigned worker)
+                { results[index] = run(tree, source, cursors[worker]); },
+                static_cast<unsigned>(cursors.size()));
+            return results;
+        }
+
+    private:
+        static auto compile(language language, const std::vector<lint_rule> &rules, std::vector<uint32_t> &offsets)
+            -> query
+        {
+            std::string source;
+            for (const lint_rule &rule : rules)
+            {
+                offsets.push_back(static_cast<uint32_t>(source.size()));
+                source += rule.query;
+                source += '\n';
+            }
+
+            try
+            {
+                return query{language, source};
+            }
+            catch (const query_error &error)
+            {
+                auto it = std::upper_bound(offsets.begin(), offsets.end(), error.offset);
+                size_t rule = static_cast<size_t>(it - offsets.begin()) - 1;
+                uint32_t offset = error.offset - offsets[rule];
+                throw query_error{offset,
+                                  error.type,
+                                  "invalid query in lint rule '" + rules[rule].name + "' at offset " +
+                                      std::to_string(offset)};
+            }
+        }
+
+        [[nodiscard]] auto find_rule(uint32_t start_byte) const -> size_t
+        {
+            auto it = std::upper_bound(rule_offsets.begin(), rule_offsets.end(), start_byte);
+            return static_cast<size_t>(it - rule_offsets.begin()) - 1;
+        }
+
+        language lang;
+        std::vector<lint_rule> rules;
+        std::vector<uint32_t> rule_offsets;
+        query fused;
+        text_predicates fused_predicates;
+        std::vector<size_t> rule_for_pattern;
+        // Fused-query capture ids of each rule's declared captures.
+        std::vector<std::vector<uint32_t>> rule_captures;
+    };
+
+}
+
+#endif
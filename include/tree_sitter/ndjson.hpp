@@ -0,0 +1,123 @@
+#ifndef CPP_TREE_SITTER_NDJSON_H
+#define CPP_TREE_SITTER_NDJSON_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "tree_sitter/batch.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+
+// Newline-delimited JSON (JSON Lines). Rather than parsing a multi-gigabyte
+// log as one document, the input is cut into newline-aligned chunks and every
+// record is parsed on its own by a pooled per-worker JSON parser. Newlines are
+// located with memchr, which the C library vectorizes.
+
+namespace ts
+{
+
+    struct ndjson_record
+    {
+        std::string_view text;
+        // Byte offset of the record within the input.
+        size_t offset;
+        // Zero-based line number of the record.
+        size_t line;
+    };
+
+    namespace detail
+    {
+        [[nodiscard]] inline auto find_newline(const char *begin, const char *end) -> const char *
+        {
+            auto *found = static_cast<const char *>(std::memchr(begin, '\n', static_cast<size_t>(end - begin)));
+            return found ? found : end;
+        }
+
+        [[nodiscard]] inline auto is_blank(std::string_view line) -> bool
+        {
+            return std::all_of(line.begin(), line.end(),
+                               [](char c) { return c == ' ' || c == '\t' || c == '\r'; });
+        }
+    }
+
+    // Splits `input` into chunks of roughly `chunk_size` bytes, each ending
+    // just after a newline (or at the end of the input).
+    [[nodiscard]] inline auto split_ndjson_chunks(std::string_view input, size_t chunk_size) -> std::vector<std::string_view>
+    {
+        std::vector<std::string_view> chunks;
+        const char *end = input.data() + input.size();
+        for (const char *begin = input.data(); begin < end;)
+        {
+            const char *cut = end - begin > static_cast<std::ptrdiff_t>(chunk_size) ? begin + chunk_size : end;
+            if (cut != end)
+            {
+                cut = detail::find_newline(cut, end);
+                cut = cut == end ? end : cut + 1;
+            }
+            chunks.emplace_back(begin, static_cast<size_t>(cut - begin));
+            begin = cut;
+        }
+        return chunks;
+    }
+
+    // Parses every non-blank line of `input` as a JSON document in parallel
+    // and calls fn(tree, record, worker). Records within a chunk arrive in
+    // order; chunks are processed concurrently. A trailing '\r' is not part of
+    // a record.
+    template <typename Fn>
+    auto parse_ndjson(std::string_view input, Fn &&fn, unsigned threads = 0, size_t chunk_size = size_t{1} << 20)
+        -> void
+    {
+        std::vector<std::string_view> chunks = split_ndjson_chunks(input, std::max<size_t>(chunk_size, 1));
+
+        // Line numbers need the newline count of every earlier chunk; counting
+        // is far cheaper than parsing, so do it up front.
+        std::vector<size_t> first_lines(chunks.size() + 1, 0);
+        parallel_for(
+            chunks.size(),
+            [&](size_t index, unsigned)
+            { first_lines[index + 1] = static_cast<size_t>(std::count(chunks[index].begin(), chunks[index].end(), '\n')); },
+            threads);
+        for (size_t index = 1; index < first_lines.size(); ++index)
+        {
+            first_lines[index] += first_lines[index - 1];
+        }
+
+        unsigned num_workers = get_worker_count(chunks.size(), threads);
+        parser_pool parsers{num_workers};
+        language json = tree_sitter_json();
+        parallel_for(
+            chunks.size(),
+            [&](size_t index, unsigned worker)
+            {
+                parser &parser = parsers.get(worker, json);
+                std::string_view chunk = chunks[index];
+                const char *end = chunk.data() + chunk.size();
+                size_t line = first_lines[index];
+                for (const char *begin = chunk.data(); begin < end; ++line)
+                {
+                    const char *newline = detail::find_newline(begin, end);
+                    std::string_view text{begin, static_cast<size_t>(newline - begin)};
+                    begin = newline == end ? end : newline + 1;
+                    if (!text.empty() && text.back() == '\r')
+                    {
+                        text.remove_suffix(1);
+                    }
+                    if (detail::is_blank(text))
+                    {
+                        continue;
+                    }
+
+                    const tree tree = parser.parse_string(text);
+                    const ndjson_record record{text, static_cast<size_t>(text.data() - input.data()), line};
+                    fn(tree, record, worker);
+                }
+            },
+            num_workers);
+    }
+
+}
+
+#endif
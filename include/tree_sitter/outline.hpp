@@ -0,0 +1,494 @@
+#ifndef CPP_TREE_SITTER_OUTLINE_H
+#define CPP_TREE_SITTER_OUTLINE_H
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "tree_sitter/batch.hpp"
+#include "tree_sitter/bundled.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+
+// Document outlines (the declarations shown in an editor's outline view or
+// returned for LSP's textDocument/documentSymbol). A per-language query
+// captures each declaration as @definition.<kind> with its @name; nesting
+// follows byte containment.
+//
+// After an edit only the entries touching the edited or changed ranges are
+// looked at: one whose declaration node survived the reparse is kept, the
+// rest are dropped and the query is re-run over just those ranges. The cost
+// of the query work depends on the size of the edit, not of the file.
+
+namespace ts
+{
+
+    inline constexpr uint32_t no_entry = std::numeric_limits<uint32_t>::max();
+
+    // Values are LSP's SymbolKind.
+    enum class outline_kind : uint8_t
+    {
+        module = 2,
+        namespace_ = 3,
+        class_ = 5,
+        method = 6,
+        property = 7,
+        field = 8,
+        constructor = 9,
+        enum_ = 10,
+        interface = 11,
+        function = 12,
+        variable = 13,
+        constant = 14,
+        object = 19,
+        enum_member = 22,
+        struct_ = 23,
+    };
+
+    struct outline_entry
+    {
+        extent<uint32_t> bytes;
+        extent<uint32_t> name_bytes;
+        // Index of the innermost enclosing entry, or no_entry.
+        uint32_t parent;
+        // Grammar symbol of the declaration node.
+        symbol type;
+        outline_kind kind;
+    };
+
+    struct document_outline
+    {
+        // In preorder: sorted by start, enclosing entries first.
+        std::vector<outline_entry> entries;
+    };
+
+    [[nodiscard]] inline auto get_outline_query(bundled_language language) -> std::string_view
+    {
+        switch (language)
+        {
+        case bundled_language::c:
+            return R"((function_definition declarator: (function_declarator declarator: (identifier) @name)) @definition.function
+(function_definition declarator: (pointer_declarator declarator: (function_declarator declarator: (identifier) @name))) @definition.function
+(struct_specifier name: (type_identifier) @name body: (_)) @definition.struct
+(union_specifier name: (type_identifier) @name body: (_)) @definition.struct
+(enum_specifier name: (type_identifier) @name body: (_)) @definition.enum
+(enumerator name: (identifier) @name) @definition.enum_member
+(field_declaration declarator: (field_identifier) @name) @definition.field
+(type_definition declarator: (type_identifier) @name) @definition.class
+(preproc_def name: (identifier) @name) @definition.constant
+(preproc_function_def name: (identifier) @name) @definition.function)";
+        case bundled_language::cpp:
+            return R"((function_definition declarator: (function_declarator declarator: (_) @name)) @definition.function
+(function_definition declarator: (pointer_declarator declarator: (function_declarator declarator: (_) @name))) @definition.function
+(function_definition declarator: (reference_declarator (function_declarator declarator: (_) @name))) @definition.function
+(field_declaration declarator: (function_declarator declarator: (_) @name)) @definition.method
+(field_declaration declarator: (field_identifier) @name) @definition.field
+(namespace_definition name: (_) @name) @definition.namespace
+(class_specifier name: (_) @name body: (_)) @definition.class
+(struct_specifier name: (_) @name body: (_)) @definition.struct
+(union_specifier name: (_) @name body: (_)) @definition.struct
+(enum_specifier name: (_) @name body: (_)) @definition.enum
+(enumerator name: (identifier) @name) @definition.enum_member
+(alias_declaration name: (type_identifier) @name) @definition.class
+(type_definition declarator: (type_identifier) @name) @definition.class
+(preproc_def name: (identifier) @name) @definition.constant
+(preproc_function_def name: (identifier) @name) @definition.function)";
+        case bundled_language::c_sharp:
+            return R"((namespace_declaration name: (_) @name) @definition.namespace
+(class_declaration name: (identifier) @name) @definition.class
+(record_declaration name: (identifier) @name) @definition.class
+(struct_declaration name: (identifier) @name) @definition.struct
+(interface_declaration name: (identifier) @name) @definition.interface
+(enum_declaration name: (identifier) @name) @definition.enum
+(enum_member_declaration name: (identifier) @name) @definition.enum_member
+(delegate_declaration name: (identifier) @name) @definition.function
+(method_declaration name: (identifier) @name) @definition.method
+(constructor_declaration name: (identifier) @name) @definition.constructor
+(property_declaration name: (identifier) @name) @definition.property)";
+        case bundled_language::go:
+            return R"((function_declaration name: (identifier) @name) @definition.function
+(method_declaration name: (field_identifier) @name) @definition.method
+(type_spec name: (type_identifier) @name type: (struct_type)) @definition.struct
+(type_spec name: (type_identifier) @name type: (interface_type)) @definition.interface
+(field_declaration name: (field_identifier) @name) @definition.field
+(method_spec name: (field_identifier) @name) @definition.method
+(const_spec name: (identifier) @name) @definition.constant)";
+        case bundled_language::java:
+            return R"((class_declaration name: (identifier) @name) @definition.class
+(record_declaration name: (identifier) @name) @definition.class
+(interface_declaration name: (identifier) @name) @definition.interface
+(annotation_type_declaration name: (identifier) @name) @definition.interface
+(enum_declaration name: (identifier) @name) @definition.enum
+(enum_constant name: (identifier) @name) @definition.enum_member
+(method_declaration name: (identifier) @name) @definition.method
+(constructor_declaration name: (identifier) @name) @definition.constructor
+(field_declaration declarator: (variable_declarator name: (identifier) @name)) @definition.field)";
+        case bundled_language::javascript:
+            return R"((class_declaration name: (identifier) @name) @definition.class
+(function_declaration name: (identifier) @name) @definition.function
+(generator_function_declaration name: (identifier) @name) @definition.function
+(method_definition name: (_) @name) @definition.method
+(field_definition property: (_) @name) @definition.field
+(variable_declarator name: (identifier) @name value: [(arrow_function) (function)]) @definition.function)";
+        case bundled_language::typescript:
+        case bundled_language::tsx:
+            return R"((module name: (_) @name) @definition.module
+(internal_module name: (_) @name) @definition.namespace
+(class_declaration name: (type_identifier) @name) @definition.class
+(abstract_class_declaration name: (type_identifier) @name) @definition.class
+(interface_declaration name: (type_identifier) @name) @definition.interface
+(type_alias_declaration name: (type_identifier) @name) @definition.class
+(enum_declaration name: (identifier) @name) @definition.enum
+(function_declaration name: (identifier) @name) @definition.function
+(generator_function_declaration name: (identifier) @name) @definition.function
+(function_signature name: (identifier) @name) @definition.function
+(method_definition name: (_) @name) @definition.method
+(method_signature name: (_) @name) @definition.method
+(abstract_method_signature name: (_) @name) @definition.method
+(public_field_definition name: (_) @name) @definition.field
+(property_signature name: (_) @name) @definition.property
+(variable_declarator name: (identifier) @name value: [(arrow_function) (function)]) @definition.function)";
+        case bundled_language::python:
+            return R"((class_definition name: (identifier) @name) @definition.class
+(function_definition name: (identifier) @name) @definition.function)";
+        case bundled_language::json:
+            return R"((pair key: (_) @name) @definition.property)";
+        case bundled_language::rust:
+            return R"((mod_item name: (identifier) @name) @definition.module
+(struct_item name: (type_identifier) @name) @definition.struct
+(union_item name: (type_identifier) @name) @definition.struct
+(enum_item name: (type_identifier) @name) @definition.enum
+(enum_variant name: (identifier) @name) @definition.enum_member
+(trait_item name: (type_identifier) @name) @definition.interface
+(impl_item type: (_) @name) @definition.object
+(function_item name: (identifier) @name) @definition.function
+(function_signature_item name: (identifier) @name) @definition.method
+(field_declaration name: (field_identifier) @name) @definition.field
+(const_item name: (identifier) @name) @definition.constant
+(static_item name: (identifier) @name) @definition.variable
+(type_item name: (type_identifier) @name) @definition.class
+(macro_definition name: (identifier) @name) @definition.function)";
+        }
+        return {};
+    }
+
+    class outline_builder
+    {
+    public:
+        // Throws query_error if the bundled query does not match the grammar.
+        explicit outline_builder(bundled_language language)
+            : outline_builder{get_language(language), get_outline_query(language)}
+        {
+        }
+
+        // Throws query_error if `query_source` does not compile.
+        outline_builder(language language, std::string_view query_source)
+            : definitions{language, query_source},
+              name_id{definitions.get_capture_id("name").value_or(no_entry)}
+        {
+            static constexpr std::pair<std::string_view, outline_kind> kind_names[] = {
+                {"module", outline_kind::module},
+                {"namespace", outline_kind::namespace_},
+                {"class", outline_kind::class_},
+                {"method", outline_kind::method},
+                {"property", outline_kind::property},
+                {"field", outline_kind::field},
+                {"constructor", outline_kind::constructor},
+                {"enum", outline_kind::enum_},
+                {"interface", outline_kind::interface},
+                {"function", outline_kind::function},
+                {"variable", outline_kind::variable},
+                {"constant", outline_kind::constant},
+                {"object", outline_kind::object},
+                {"enum_member", outline_kind::enum_member},
+                {"struct", outline_kind::struct_},
+            };
+            kinds.resize(definitions.get_num_captures());
+            for (uint32_t id = 0; id < kinds.size(); ++id)
+            {
+                std::string_view name = definitions.get_capture_name(id);
+                if (!name.starts_with("definition."))
+                {
+                    continue;
+                }
+                name.remove_prefix(std::string_view{"definition."}.size());
+                for (const auto &[kind_name, kind] : kind_names)
+                {
+                    if (name == kind_name)
+                    {
+                        kinds[id] = kind;
+                    }
+                }
+            }
+        }
+
+        auto build(const tree &tree, query_cursor &cursor, document_outline &outline) const -> void
+        {
+            outline.entries.clear();
+            cursor.set_byte_range({0, std::numeric_limits<uint32_t>::max()});
+            collect(tree, cursor, outline.entries);
+            std::stable_sort(outline.entries.begin(), outline.entries.end(), precedes);
+            link(outline);
+        }
+
+        [[nodiscard]] auto build(const tree &tree, query_cursor &cursor) const -> document_outline
+        {
+            document_outline outline;
+            build(tree, cursor, outline);
+            return outline;
+        }
+
+        // Brings `outline` up to date after `edit`. `old_tree` is the previous
+        // tree after tree::edit, and `new_tree` was reparsed from it.
+        auto update(document_outline &outline,
+                    const TSInputEdit &edit,
+                    const tree &old_tree,
+                    const tree &new_tree,
+                    query_cursor &cursor) const -> void
+        {
+            shift(outline, edit);
+
+            // The edit itself and every range whose structure changed, each
+            // widened by a byte so that nodes ending or starting at its
+            // boundary count as touching it.
+            std::vector<extent<uint32_t>> dirty{{edit.start_byte, edit.new_end_byte}};
+            for (const TSRange &range : old_tree.get_changed_ranges(new_tree))
+            {
+                dirty.push_back({range.start_byte, range.end_byte});
+            }
+            std::sort(dirty.begin(),
+                      dirty.end(),
+                      [](extent<uint32_t> a, extent<uint32_t> b) { return a.start < b.start; });
+            std::vector<extent<uint32_t>> merged;
+            for (extent<uint32_t> range : dirty)
+            {
+                range.start = range.start > 0 ? range.start - 1 : 0;
+                range.end = range.end < std::numeric_limits<uint32_t>::max() ? range.end + 1 : range.end;
+                if (!merged.empty() && range.start <= merged.back().end)
+                {
+                    merged.back().end = std::max(merged.back().end, range.end);
+                }
+                else
+                {
+                    merged.push_back(range);
+                }
+            }
+
+            auto touches = [&](extent<uint32_t> bytes)
+            {
+                auto it = std::lower_bound(merged.begin(),
+                                           merged.end(),
+                                           bytes.start,
+                                           [](extent<uint32_t> range, uint32_t start) { return range.end < start; });
+                return it != merged.end() && it->start <= bytes.end;
+            };
+            node root = new_tree.get_root_node();
+            std::erase_if(outline.entries,
+                          [&](const outline_entry &entry)
+                          {
+                              return touches(entry.bytes) && (touches(entry.name_bytes) || !survives(root, entry));
+                          });
+
+            std::vector<outline_entry> added;
+            for (extent<uint32_t> range : merged)
+            {
+                cursor.set_byte_range(range);
+                collect(new_tree, cursor, added);
+            }
+            cursor.set_byte_range({0, std::numeric_limits<uint32_t>::max()});
+            std::stable_sort(added.begin(), added.end(), precedes);
+
+            // Matches for entries that were kept come back too; keep the
+            // existing entry, which precedes its copy after the merge. The
+            // sort key covers everything compared here, so copies are
+            // neighbours even where several entries share one node.
+            auto middle = static_cast<std::ptrdiff_t>(outline.entries.size());
+            outline.entries.insert(outline.entries.end(), added.begin(), added.end());
+            std::inplace_merge(
+                outline.entries.begin(), outline.entries.begin() + middle, outline.entries.end(), precedes);
+            auto duplicate = std::unique(outline.entries.begin(),
+                                         outline.entries.end(),
+                                         [](const outline_entry &a, const outline_entry &b)
+                                         {
+                                             return a.bytes.start == b.bytes.start && a.bytes.end == b.bytes.end &&
+                                                    a.name_bytes.start == b.name_bytes.start &&
+                                                    a.name_bytes.end == b.name_bytes.end && a.type == b.type;
+                                         });
+            outline.entries.erase(duplicate, outline.entries.end());
+            link(outline);
+        }
+
+    private:
+        // Source order, with an enclosing declaration before those inside it.
+        // Declarations sharing a node (`int x, y;`) follow their names, so
+        // copies of the same entry are always adjacent.
+        static auto precedes(const outline_entry &a, const outline_entry &b) -> bool
+        {
+            if (a.bytes.start != b.bytes.start)
+            {
+                return a.bytes.start < b.bytes.start;
+            }
+            if (a.bytes.end != b.bytes.end)
+            {
+                return a.bytes.end > b.bytes.end;
+            }
+            if (a.name_bytes.start != b.name_bytes.start)
+            {
+                return a.name_bytes.start < b.name_bytes.start;
+            }
+            if (a.name_bytes.end != b.name_bytes.end)
+            {
+                return a.name_bytes.end < b.name_bytes.end;
+            }
+            return a.type < b.type;
+        }
+
+        auto collect(const tree &tree, query_cursor &cursor, std::vector<outline_entry> &entries) const -> void
+        {
+            cursor.exec(definitions, tree.get_root_node());
+            query_match match;
+            while (cursor.next_match(match))
+            {
+                std::optional<outline_entry> entry;
+                std::optional<extent<uint32_t>> name_bytes;
+                for (uint32_t i = 0; i < match.get_num_captures(); ++i)
+                {
+                    uint32_t id = match.get_capture_id(i);
+                    if (id == name_id)
+                    {
+                        name_bytes = match.get_capture_node(i).get_byte_range();
+                    }
+                    else if (kinds[id])
+                    {
+                        node definition = match.get_capture_node(i);
+                        entry = outline_entry{
+                            definition.get_byte_range(), {}, no_entry, definition.get_symbol(), *kinds[id]};
+                    }
+                }
+                if (entry)
+                {
+                    entry->name_bytes = name_bytes.value_or(entry->bytes);
+                    entries.push_back(*entry);
+                }
+            }
+        }
+
+        // Sets every parent from strict containment; entries with the same
+        // range are siblings. A function directly inside a class-like entry
+        // is a method.
+        static auto link(document_outline &outline) -> void
+        {
+            std::vector<uint32_t> stack;
+            for (uint32_t index = 0; index < outline.entries.size(); ++index)
+            {
+                outline_entry &entry = outline.entries[index];
+                while (!stack.empty())
+                {
+                    extent<uint32_t> top = outline.entries[stack.back()].bytes;
+                    if (entry.bytes.end < top.end || (entry.bytes.end == top.end && entry.bytes.start > top.start))
+                    {
+                        break;
+                    }
+                    stack.pop_back();
+                }
+                entry.parent = stack.empty() ? no_entry : stack.back();
+                if (entry.kind == outline_kind::function && entry.parent != no_entry)
+                {
+                    outline_kind parent_kind = outline.entries[entry.parent].kind;
+                    if (parent_kind == outline_kind::class_ || parent_kind == outline_kind::struct_ ||
+                        parent_kind == outline_kind::interface || parent_kind == outline_kind::object)
+                    {
+                        entry.kind = outline_kind::method;
+                    }
+                }
+                stack.push_back(index);
+            }
+        }
+
+        // Whether the new tree still has a node of the entry's type at its
+        // (shifted) range.
+        [[nodiscard]] static auto survives(node root, const outline_entry &entry) -> bool
+        {
+            for (node node = root.get_descendant_for_byte_range(entry.bytes); !node.is_null(); node = node.get_parent())
+            {
+                extent<uint32_t> bytes = node.get_byte_range();
+                if (bytes.start != entry.bytes.start || bytes.end != entry.bytes.end)
+                {
+                    return false;
+                }
+                if (node.get_symbol() == entry.type)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Moves every stored byte offset to where it lands after `edit`.
+        static auto shift(document_outline &outline, const TSInputEdit &edit) -> void
+        {
+            auto move = [&](uint32_t &byte)
+            {
+                if (byte >= edit.old_end_byte)
+                {
+                    byte = byte - edit.old_end_byte + edit.new_end_byte;
+                }
+                else if (byte > edit.start_byte)
+                {
+                    byte = edit.start_byte;
+                }
+            };
+            for (outline_entry &entry : outline.entries)
+            {
+                move(entry.bytes.start);
+                move(entry.bytes.end);
+                move(entry.name_bytes.start);
+                move(entry.name_bytes.end);
+            }
+        }
+
+        query definitions;
+        uint32_t name_id;
+        // The kind each capture stands for, if it is a @definition.<kind>.
+        std::vector<std::optional<outline_kind>> kinds;
+    };
+
+    // Builds the outline of every file in parallel; the outline of files[i]
+    // is element i.
+    [[nodiscard]] inline auto build_outlines(std::span<const source_file> files, unsigned threads = 0)
+        -> std::vector<document_outline>
+    {
+        std::array<std::unique_ptr<outline_builder>, std::size(bundled_languages)> builders;
+        for (const source_file &file : files)
+        {
+            auto &slot = builders[static_cast<size_t>(file.language)];
+            if (!slot)
+            {
+                slot = std::make_unique<outline_builder>(file.language);
+            }
+        }
+
+        std::vector<document_outline> results(files.size());
+        unsigned num_workers = get_worker_count(files.size(), threads);
+        parser_pool parsers{num_workers};
+        std::vector<query_cursor> cursors(num_workers);
+        parallel_for(
+            files.size(),
+            [&](size_t index, unsigned worker)
+            {
+                const source_file &file = files[index];
+                tree tree = parsers.get(worker, get_language(file.language)).parse_string(file.text);
+                builders[static_cast<size_t>(file.language)]->build(tree, cursors[worker], results[index]);
+            },
+            num_workers);
+        return results;
+    }
+
+}
+
+#endif
@@ -0,0 +1,654 @@
+#ifndef CPP_TREE_SITTER_PARSE_SERVER_H
+#define CPP_TREE_SITTER_PARSE_SERVER_H
+
+#include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tree_sitter/batch.hpp"
+#include "tree_sitter/bundled.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/flat_tree.hpp"
+#include "tree_sitter/text_predicates.hpp"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// A long-running parse service for clients that cannot afford to load the
+// grammars themselves, plus the binary formats it speaks. A fixed set of
+// worker threads takes requests off one queue as soon as each is free, so
+// concurrent requests from any number of clients share the parsers, query
+// cursors and compiled queries, and no thread is started per request.
+//
+// Everything is in host byte order, as both ends share a machine. Frames are
+// a uint32 body length followed by the body:
+//
+//   request:  u32 id, u8 kind, u8 language, u8 flags, u8 0,
+//             u32 source length, source, u32 query length, query
+//   response: u32 id, u8 status, u8 flags, u16 0, payload
+//
+// A failed request carries its error message as payload. Otherwise the
+// payload depends on the kind:
+//
+//   parse:    the tree, see encode_flat_tree
+//   query:    u32 capture name count, names, u32 capture count,
+//             per capture u32 pattern, capture id, start byte, end byte
+//   describe: u32 symbol count, per symbol u8 TSSymbolType and a name,
+//             u32 field count (field 0 included), field names
+//
+// where every name is a u32 length followed by its bytes.
+//
+// On Linux a parse request with the shared-memory flag gets its tree in a
+// sealed memfd instead: the tree is encoded straight into the mapping, the
+// response flag is set, its payload is the u64 size of the tree, and the
+// descriptor travels with the response frame as SCM_RIGHTS ancillary data.
+// The client maps it read-only and reads it with flat_tree_view, so large
+// trees are never copied through the socket.
+
+namespace ts
+{
+
+    namespace detail
+    {
+        template <typename T>
+        auto put(std::string &out, T value) -> void
+        {
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            out.append(bytes, sizeof(T));
+        }
+
+        inline auto put_string(std::string &out, std::string_view text) -> void
+        {
+            put(out, static_cast<uint32_t>(text.size()));
+            out.append(text);
+        }
+
+        template <typename T>
+        [[nodiscard]] auto get(std::string_view in, size_t offset) -> T
+        {
+            T value;
+            std::memcpy(&value, in.data() + offset, sizeof(T));
+            return value;
+        }
+
+        // Reads values front to back, failing once the input runs out.
+        struct wire_reader
+        {
+            template <typename T>
+            auto read(T &value) -> bool
+            {
+                if (in.size() - offset < sizeof(T))
+                {
+                    return false;
+                }
+                value = get<T>(in, offset);
+                offset += sizeof(T);
+                return true;
+            }
+
+            auto read_string(std::string_view &text) -> bool
+            {
+                uint32_t length = 0;
+                if (!read(length) || in.size() - offset < length)
+                {
+                    return false;
+                }
+                text = in.substr(offset, length);
+                offset += length;
+                return true;
+            }
+
+            std::string_view in;
+            size_t offset = 0;
+        };
+    }
+
+    // "TSFT" at the start of an encoded tree.
+    inline constexpr uint32_t tree_format_magic = 0x54465354;
+
+    // Size of `tree` once encoded.
+    [[nodiscard]] inline auto get_encoded_size(const flat_tree &tree) -> size_t
+    {
+        size_t count = tree.size();
+        return 8 + count * 25 + (4 - count % 4) % 4;
+    }
+
+    // Writes `tree` to the get_encoded_size(tree) bytes at `out` as: u32
+    // magic, u32 node count N, then the columns u16 symbols[N],
+    // u16 fields[N], u8 flags[N] padded to 4 bytes, and u32 parents[N],
+    // ends[N], depths[N], start bytes[N], end bytes[N]. The columns mean what
+    // the flat_tree accessors of the same name return; flags hold named (1),
+    // extra (2) and missing (4).
+    inline auto encode_flat_tree(const flat_tree &tree, char *out) -> void
+    {
+        auto put = [&](auto value)
+        {
+            std::memcpy(out, &value, sizeof(value));
+            out += sizeof(value);
+        };
+        node_position count = tree.size();
+        put(tree_format_magic);
+        put(count);
+        for (node_position position = 0; position < count; ++position)
+        {
+            put(tree.get_symbol(position));
+        }
+        for (node_position position = 0; position < count; ++position)
+        {
+            put(tree.get_field_id(position));
+        }
+        for (node_position position = 0; position < count; ++position)
+        {
+            put(static_cast<uint8_t>((tree.is_named(position) ? 1 : 0) | (tree.is_extra(position) ? 2 : 0) |
+                                     (tree.is_missing(position) ? 4 : 0)));
+        }
+        for (size_t padding = (4 - count % 4) % 4; padding > 0; --padding)
+        {
+            put(uint8_t{0});
+        }
+        for (node_position position = 0; position < count; ++position)
+        {
+            put(tree.get_parent(position));
+        }
+        for (node_position position = 0; position < count; ++position)
+        {
+            put(tree.get_subtree_end(position));
+        }
+        for (node_position position = 0; position < count; ++position)
+        {
+            put(tree.get_depth(position));
+        }
+        for (node_position position = 0; position < count; ++position)
+        {
+            put(tree.get_byte_range(position).start);
+        }
+        for (node_position position = 0; position < count; ++position)
+        {
+            put(tree.get_byte_range(position).end);
+        }
+    }
+
+    // Appends `tree`, encoded as above.
+    inline auto encode_flat_tree(const flat_tree &tree, std::string &out) -> void
+    {
+        size_t offset = out.size();
+        out.resize(offset + get_encoded_size(tree));
+        encode_flat_tree(tree, out.data() + offset);
+    }
+
+    // Read-only access to an encoded tree in place, with the accessors of
+    // flat_tree. The buffer must outlive the view.
+    class flat_tree_view
+    {
+    public:
+        // Throws std::runtime_error if `data` does not hold a whole tree.
+        explicit flat_tree_view(std::string_view data)
+            : data{data}
+        {
+            if (data.size() < 8 || detail::get<uint32_t>(data, 0) != tree_format_magic)
+            {
+                throw std::runtime_error{"not an encoded tree"};
+            }
+            count = detail::get<node_position>(data, 4);
+            size_t padding = (4 - count % 4) % 4;
+            if (data.size() < 8 + size_t{count} * 25 + padding)
+            {
+                throw std::runtime_error{"truncated tree"};
+            }
+            fields = 8 + size_t{count} * 2;
+            flags = fields + size_t{count} * 2;
+            parents = flags + count + padding;
+            ends = parents + size_t{count} * 4;
+            depths = ends + size_t{count} * 4;
+            starts = depths + size_t{count} * 4;
+            stops = starts + size_t{count} * 4;
+        }
+
+        [[nodiscard]] auto size() const -> node_position
+        {
+            return count;
+        }
+
+        [[nodiscard]] auto get_symbol(node_position position) const -> symbol
+        {
+            return detail::get<symbol>(data, 8 + size_t{position} * 2);
+        }
+
+        [[nodiscard]] auto get_field_id(node_position position) const -> field_id
+        {
+            return detail::get<field_id>(data, fields + size_t{position} * 2);
+        }
+
+        [[nodiscard]] auto is_named(node_position position) const -> bool
+        {
+            return data[flags + position] & 1;
+        }
+
+        [[nodiscard]] auto is_extra(node_position position) const -> bool
+        {
+            return data[flags + position] & 2;
+        }
+
+        [[nodiscard]] auto is_missing(node_position position) const -> bool
+        {
+            return data[flags + position] & 4;
+        }
+
+        [[nodiscard]] auto get_parent(node_position position) const -> node_position
+        {
+            return get_column(parents, position);
+        }
+
+        [[nodiscard]] auto get_depth(node_position position) const -> uint32_t
+        {
+            return get_column(depths, position);
+        }
+
+        [[nodiscard]] auto get_subtree_end(node_position position) const -> node_position
+        {
+            return get_column(ends, position);
+        }
+
+        [[nodiscard]] auto get_first_child(node_position position) const -> node_position
+        {
+            return get_subtree_end(position) > position + 1 ? position + 1 : no_position;
+        }
+
+        [[nodiscard]] auto get_next_sibling(node_position position) const -> node_position
+        {
+            node_position parent = get_parent(position);
+            node_position end = get_subtree_end(position);
+            return parent != no_position && end < get_subtree_end(parent) ? end : no_position;
+        }
+
+        [[nodiscard]] auto get_byte_range(node_position position) const -> extent<uint32_t>
+        {
+            return {get_column(starts, position), get_column(stops, position)};
+        }
+
+    private:
+        [[nodiscard]] auto get_column(size_t column, node_position position) const -> uint32_t
+        {
+            return detail::get<uint32_t>(data, column + size_t{position} * 4);
+        }
+
+        std::string_view data;
+        node_position count = 0;
+        size_t fields = 0;
+        size_t flags = 0;
+        size_t parents = 0;
+        size_t ends = 0;
+        size_t depths = 0;
+        size_t starts = 0;
+        size_t stops = 0;
+    };
+
+    enum class parse_request_kind : uint8_t
+    {
+        parse,
+        query,
+        describe,
+    };
+
+    struct parse_request
+    {
+        uint32_t id = 0;
+        parse_request_kind kind = parse_request_kind::parse;
+        bundled_language language = bundled_language::c;
+        std::string source;
+        // Query source, for parse_request_kind::query.
+        std::string query;
+        // Return a parsed tree in shared memory, where supported.
+        bool shared_memory = false;
+    };
+
+    enum class parse_status : uint8_t
+    {
+        ok,
+        error,
+    };
+
+    struct parse_response
+    {
+        uint32_t id = 0;
+        parse_status status = parse_status::ok;
+        std::string payload;
+        // Set when the result is in a memfd; the payload is then its u64
+        // size. On the server, `memory_fd` is that descriptor and whoever
+        // sends the response closes it. decode_response leaves it at -1 for
+        // the client to fill from the ancillary data.
+        bool in_shared_memory = false;
+        int memory_fd = -1;
+    };
+
+    // Appends `request` as a whole frame.
+    inline auto encode_request(const parse_request &request, std::string &out) -> void
+    {
+        detail::put(out, static_cast<uint32_t>(16 + request.source.size() + request.query.size()));
+        detail::put(out, request.id);
+        out.push_back(static_cast<char>(request.kind));
+        out.push_back(static_cast<char>(request.language));
+        out.push_back(static_cast<char>(request.shared_memory ? 1 : 0));
+        out.push_back('\0');
+        detail::put_string(out, request.source);
+        detail::put_string(out, request.query);
+    }
+
+    // Reads a request from a frame body. Returns false if it is malformed.
+    [[nodiscard]] inline auto decode_request(std::string_view body, parse_request &request) -> bool
+    {
+        detail::wire_reader reader{body};
+        uint8_t kind = 0;
+        uint8_t language = 0;
+        uint8_t flags = 0;
+        uint8_t reserved = 0;
+        std::string_view source;
+        std::string_view query;
+        if (!reader.read(request.id) || !reader.read(kind) || !reader.read(language) || !reader.read(flags) ||
+            !reader.read(reserved) || !reader.read_string(source) || !reader.read_string(query) ||
+            kind > static_cast<uint8_t>(parse_request_kind::describe) || language >= std::size(bundled_languages))
+        {
+            return false;
+        }
+        request.shared_memory = flags & 1;
+        request.kind = static_cast<parse_request_kind>(kind);
+        request.language = static_cast<bundled_language>(language);
+        request.source.assign(source);
+        request.query.assign(query);
+        return true;
+    }
+
+    // Appends `response` as a whole frame.
+    inline auto encode_response(const parse_response &response, std::string &out) -> void
+    {
+        detail::put(out, static_cast<uint32_t>(8 + response.payload.size()));
+        detail::put(out, response.id);
+        out.push_back(static_cast<char>(response.status));
+        out.push_back(static_cast<char>(response.in_shared_memory ? 1 : 0));
+        out.append(2, '\0');
+        out.append(response.payload);
+    }
+
+    // Reads a response from a frame body. Returns false if it is malformed.
+    [[nodiscard]] inline auto decode_response(std::string_view body, parse_response &response) -> bool
+    {
+        if (body.size() < 8 || static_cast<uint8_t>(body[4]) > static_cast<uint8_t>(parse_status::error))
+        {
+            return false;
+        }
+        response.id = detail::get<uint32_t>(body, 0);
+        response.status = static_cast<parse_status>(body[4]);
+        response.in_shared_memory = body[5] & 1;
+        response.memory_fd = -1;
+        response.payload.assign(body.substr(8));
+        return true;
+    }
+
+#if defined(__linux__)
+    // Encodes `tree` straight into a new memfd and seals it against any
+    // further change. Returns the descriptor; `size` is set to the size of
+    // the encoding. Throws std::system_error on failure.
+    [[nodiscard]] inline auto encode_shared_flat_tree(const flat_tree &tree, size_t &size) -> int
+    {
+        size = get_encoded_size(tree);
+        int fd = memfd_create("tree-sitter-tree", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (fd < 0)
+        {
+            throw std::system_error{errno, std::generic_category(), "memfd_create"};
+        }
+        void *memory = MAP_FAILED;
+        if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+        {
+            memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        if (memory == MAP_FAILED)
+        {
+            int error = errno;
+            close(fd);
+            throw std::system_error{error, std::generic_category(), "mapping shared tree"};
+        }
+        encode_flat_tree(tree, static_cast<char *>(memory));
+        munmap(memory, size);
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+        return fd;
+    }
+#endif
+
+    class parse_server
+    {
+    public:
+        // Called on a worker thread once a request has been answered. It
+        // holds up that worker, so it should hand the response over (to a
+        // writer thread, say) rather than block on I/O. Must not throw.
+        using completion = std::function<void(parse_response &&)>;
+
+        // Starts `threads` workers, or one per core for 0.
+        explicit parse_server(unsigned threads = 0)
+            : pool{get_worker_count(std::numeric_limits<size_t>::max(), threads)},
+              workers(pool.get_num_workers())
+        {
+            worker_threads.reserve(pool.get_num_workers());
+            for (unsigned worker = 0; worker < pool.get_num_workers(); ++worker)
+            {
+                worker_threads.emplace_back([this, worker](std::stop_token stop) { work(stop, worker); });
+            }
+        }
+
+        parse_server(const parse_server &) = delete;
+        auto operator=(const parse_server &) -> parse_server & = delete;
+
+        // Lets every worker finish its current request. Requests still
+        // queued are dropped without calling their completions.
+        ~parse_server()
+        {
+            for (std::jthread &thread : worker_threads)
+            {
+                thread.request_stop();
+            }
+            worker_threads.clear();
+        }
+
+        // Queues `request` for the next free worker.
+        auto submit(parse_request request, completion done) -> void
+        {
+            {
+                std::lock_guard lock{queue_lock};
+                queue.push_back({std::move(request), std::move(done)});
+            }
+            queue_ready.notify_one();
+        }
+
+    private:
+        struct pending
+        {
+            parse_request request;
+            completion done;
+        };
+
+        struct compiled_query
+        {
+            compiled_query(language language, std::string_view source)
+                : patterns{language, source},
+                  predicates{patterns}
+            {
+            }
+
+            query patterns;
+            text_predicates predicates;
+        };
+
+        // What a worker keeps between requests.
+        struct worker_state
+        {
+            query_cursor cursor;
+            flat_tree flat;
+        };
+
+        auto work(std::stop_token stop, unsigned worker) -> void
+        {
+            while (true)
+            {
+                pending next;
+                {
+                    std::unique_lock lock{queue_lock};
+                    if (!queue_ready.wait(lock, stop, [&] { return !queue.empty(); }))
+                    {
+                        return;
+                    }
+                    next = std::move(queue.front());
+                    queue.pop_front();
+                }
+                parse_response response;
+                respond(next.request, response, worker);
+                next.done(std::move(response));
+            }
+        }
+
+        auto respond(const parse_request &request, parse_response &response, unsigned worker) -> void
+        {
+            response.id = request.id;
+            try
+            {
+                language language = get_language(request.language);
+                if (request.kind == parse_request_kind::describe)
+                {
+                    describe(language, response.payload);
+                    return;
+                }
+
+                tree tree = pool.get(worker, language).parse_string(request.source);
+                worker_state &state = workers[worker];
+                if (request.kind == parse_request_kind::parse)
+                {
+                    state.flat.assign(tree.get_root_node());
+#if defined(__linux__)
+                    if (request.shared_memory)
+                    {
+                        size_t size = 0;
+                        response.memory_fd = encode_shared_flat_tree(state.flat, size);
+                        response.in_shared_memory = true;
+                        detail::put(response.payload, static_cast<uint64_t>(size));
+                        return;
+                    }
+#endif
+                    encode_flat_tree(state.flat, response.payload);
+                    return;
+                }
+
+                std::shared_ptr<const compiled_query> compiled = get_query(request.language, request.query);
+                const query &patterns = compiled->patterns;
+                std::string &out = response.payload;
+                detail::put(out, patterns.get_num_captures());
+                for (uint32_t id = 0; id < patterns.get_num_captures(); ++id)
+                {
+                    detail::put_string(out, patterns.get_capture_name(id));
+                }
+                size_t count_offset = out.size();
+                detail::put(out, uint32_t{0});
+                uint32_t count = 0;
+                state.cursor.exec(patterns, tree.get_root_node());
+                query_match match;
+                uint32_t capture_position = 0;
+                while (state.cursor.next_capture(match, capture_position))
+                {
+                    if (!compiled->predicates.satisfies(match, request.source))
+                    {
+                        continue;
+                    }
+                    extent<uint32_t> bytes = match.get_capture_node(capture_position).get_byte_range();
+                    detail::put(out, match.get_pattern_index());
+                    detail::put(out, match.get_capture_id(capture_position));
+                    detail::put(out, bytes.start);
+                    detail::put(out, bytes.end);
+                    ++count;
+                }
+                std::memcpy(out.data() + count_offset, &count, sizeof(count));
+            }
+            catch (const std::exception &failure)
+            {
+                response.status = parse_status::error;
+                response.payload = failure.what();
+            }
+        }
+
+        static auto describe(language language, std::string &out) -> void
+        {
+            auto num_symbols = static_cast<uint32_t>(language.get_num_symbols());
+            detail::put(out, num_symbols);
+            for (symbol id = 0; id < num_symbols; ++id)
+            {
+                out.push_back(static_cast<char>(language.get_symbol_type(id)));
+                detail::put_string(out, language.get_symbol_name(id));
+            }
+            auto num_fields = static_cast<uint32_t>(language.get_num_fields());
+            detail::put(out, num_fields + 1);
+            for (field_id id = 0; id <= num_fields; ++id)
+            {
+                detail::put_string(out, language.get_field_name(id));
+            }
+        }
+
+        // Compiled queries are shared by every worker and kept until too
+        // many distinct ones have been seen.
+        auto get_query(bundled_language language, const std::string &source) -> std::shared_ptr<const compiled_query>
+        {
+            auto &cache = queries[static_cast<size_t>(language)];
+            {
+                std::lock_guard lock{queries_lock};
+                auto found = cache.find(source);
+                if (found != cache.end())
+                {
+                    return found->second;
+                }
+            }
+            auto compiled = std::make_shared<const compiled_query>(get_language(language), source);
+            std::lock_guard lock{queries_lock};
+            if (cache.size() >= max_cached_queries)
+            {
+                cache.clear();
+            }
+            cache.emplace(source, compiled);
+            return compiled;
+        }
+
+        static constexpr size_t max_cached_queries = 64;
+
+        parser_pool pool;
+        std::vector<worker_state> workers;
+
+        std::mutex queries_lock;
+        std::array<std::unordered_map<std::string, std::shared_ptr<const compiled_query>>, std::size(bundled_languages)>
+            queries;
+
+        std::mutex queue_lock;
+        std::condition_variable_any queue_ready;
+        std::deque<pending> queue;
+
+        // Last, so that the workers start once everything above exists and
+        // are joined before any of it is destroyed.
+        std::vector<std::jthread> worker_threads;
+    };
+
+}
+
+#endif
@@ -0,0 +1,512 @@
+#ifndef CPP_TREE_SITTER_SCOPES_H
+#define CPP_TREE_SITTER_SCOPES_H
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/text_predicates.hpp"
+
+// Scope and binding resolution driven by a grammar's `locals.scm`. The
+// captures understood are those of tree-sitter-highlight: @local.scope,
+// @local.definition[.kind] and @local.reference (the `local.` prefix is
+// optional), plus `(#set! local.scope-inherits false)` on scope patterns.
+
+namespace ts
+{
+
+    inline constexpr uint32_t no_local = std::numeric_limits<uint32_t>::max();
+
+    struct local_scope
+    {
+        extent<uint32_t> bytes;
+        uint32_t parent;
+        uint32_t depth;
+        bool inherits;
+    };
+
+    struct local_definition
+    {
+        extent<uint32_t> bytes;
+        uint32_t scope;
+        uint32_t capture;
+    };
+
+    struct local_reference
+    {
+        extent<uint32_t> bytes;
+        uint32_t scope;
+        // Index into scope_map::definitions, or no_local if unresolved.
+        uint32_t definition;
+    };
+
+    // The scopes of one file as flat arrays. Scopes are in preorder, with
+    // scope 0 covering the whole file; definitions and references are sorted
+    // by start byte.
+    struct scope_map
+    {
+        std::vector<local_scope> scopes;
+        std::vector<local_definition> definitions;
+        std::vector<local_reference> references;
+
+        // Returns the innermost scope containing `byte`.
+        [[nodiscard]] auto find_scope(uint32_t byte) const -> uint32_t
+        {
+            auto it = std::upper_bound(scopes.begin(), scopes.end(), byte,
+                                       [](uint32_t byte, const local_scope &scope)
+                                       { return byte < scope.bytes.start; });
+            uint32_t scope = it == scopes.begin() ? 0 : static_cast<uint32_t>(it - scopes.begin()) - 1;
+            while (scope != 0 && byte >= scopes[scope].bytes.end)
+            {
+                scope = scopes[scope].parent;
+            }
+            return scope;
+        }
+
+        // Returns the definition whose name spans `byte`, or no_local.
+        [[nodiscard]] auto find_definition(uint32_t byte) const -> uint32_t
+        {
+            return find_at(definitions, byte);
+        }
+
+        // Returns the reference whose name spans `byte`, or no_local.
+        [[nodiscard]] auto find_reference(uint32_t byte) const -> uint32_t
+        {
+            return find_at(references, byte);
+        }
+
+        [[nodiscard]] auto get_references_to(uint32_t definition) const -> std::vector<uint32_t>
+        {
+            std::vector<uint32_t> result;
+            for (uint32_t reference = 0; reference < references.size(); ++reference)
+            {
+                if (references[reference].definition == definition)
+                {
+                    result.push_back(reference);
+                }
+            }
+            return result;
+        }
+
+    private:
+        template <typename Entry>
+        [[nodiscard]] static auto find_at(const std::vector<Entry> &entries, uint32_t byte) -> uint32_t
+        {
+            auto it = std::upper_bound(entries.begin(), entries.end(), byte,
+                                       [](uint32_t byte, const Entry &entry) { return byte < entry.bytes.start; });
+            if (it == entries.begin() || byte >= std::prev(it)->bytes.end)
+            {
+                return no_local;
+            }
+            return static_cast<uint32_t>(it - entries.begin()) - 1;
+        }
+    };
+
+    class scopes
+    {
+    public:
+        // Throws query_error if `locals_query` does not compile.
+        scopes(language language, std::string_view locals_query)
+            : locals{language, locals_query},
+              local_predicates{locals}
+        {
+            for (uint32_t id = 0; id < locals.get_num_captures(); ++id)
+            {
+                std::string_view name = locals.get_capture_name(id);
+                if (name.starts_with("local."))
+                {
+                    name.remove_prefix(6);
+                }
+
+                if (name == "scope")
+                {
+                    roles.push_back(role::scope);
+                }
+                else if (name == "reference")
+                {
+                    roles.push_back(role::reference);
+                }
+                else if (name.starts_with("definition"))
+                {
+                    roles.push_back(role::definition);
+                }
+                else
+                {
+                    roles.push_back(role::none);
+                }
+            }
+        }
+
+        // Returns the kind suffix of a definition's capture, e.g. "function"
+        // for @local.definition.function, or an empty string.
+        [[nodiscard]] auto get_definition_kind(const local_definition &definition) const -> std::string_view
+        {
+            std::string_view name = locals.get_capture_name(definition.capture);
+            size_t dot = name.find("definition.");
+            return dot == std::string_view::npos ? std::string_view{} : name.substr(dot + 11);
+        }
+
+        [[nodiscard]] auto build(const tree &tree, std::string_view source, query_cursor &cursor) const -> scope_map
+        {
+            scope_map map;
+            map.scopes.push_back({{0, static_cast<uint32_t>(source.size())}, no_local, 0, true});
+
+            resolver resolver;
+            resolver.push(0, map.scopes[0]);
+            cursor.set_byte_range({0, std::numeric_limits<uint32_t>::max()});
+            collect(map, resolver, tree, source, cursor, map.scopes[0].bytes, false);
+            return map;
+        }
+
+        [[nodiscard]] auto build(const tree &tree, std::string_view source) const -> scope_map
+        {
+            query_cursor cursor;
+            return build(tree, source, cursor);
+        }
+
+        // Brings `map` up to date after `edit`. `old_tree` is the previous
+        // tree after tree::edit, and `new_tree` was reparsed from it. Only the
+        // innermost scope enclosing every changed range is re-queried; entries
+        // elsewhere are shifted in place.
+        auto update(scope_map &map,
+                    const TSInputEdit &edit,
+                    const tree &old_tree,
+                    const tree &new_tree,
+                    std::string_view new_source,
+                    query_cursor &cursor) const -> void
+        {
+            shift(map, edit, static_cast<uint32_t>(new_source.size()));
+
+            extent<uint32_t> dirty{edit.start_byte, edit.new_end_byte};
+            for (const TSRange &range : old_tree.get_changed_ranges(new_tree))
+            {
+                dirty.start = std::min(dirty.start, range.start_byte);
+                dirty.end = std::max(dirty.end, range.end_byte);
+            }
+
+            uint32_t scope = map.find_scope(dirty.start);
+            while (scope != 0 &&
+                   !(map.scopes[scope].bytes.start < dirty.start && dirty.end < map.scopes[scope].bytes.end))
+            {
+                scope = map.scopes[scope].parent;
+            }
+
+            if (scope == 0)
+            {
+                map = build(new_tree, new_source, cursor);
+                return;
+            }
+            rebuild(map, scope, new_tree, new_source, cursor);
+        }
+
+    private:
+        enum class role : uint8_t
+        {
+            none,
+            scope,
+            definition,
+            reference,
+        };
+
+        // Tracks the definitions visible at the current position. Each name
+        // maps to a stack of definitions, innermost last; leaving a scope
+        // unwinds the definitions it introduced.
+        class resolver
+        {
+        public:
+            auto push(uint32_t scope, const local_scope &entry) -> void
+            {
+                uint32_t barrier = 0;
+                if (!stack.empty())
+                {
+                    barrier = entry.inherits ? stack.back().barrier : entry.depth;
+                }
+                stack.push_back({scope, entry.bytes.end, entry.depth, barrier, log.size()});
+            }
+
+            // Leaves every scope that ends at or before `byte`, but never the
+            // first `keep` scopes.
+            auto leave_until(uint32_t byte, size_t keep) -> void
+            {
+                while (stack.size() > keep && byte >= stack.back().end)
+                {
+                    for (size_t i = log.size(); i > stack.back().log_mark; --i)
+                    {
+                        visible[log[i - 1]].pop_back();
+                    }
+                    log.resize(stack.back().log_mark);
+                    stack.pop_back();
+                }
+            }
+
+            auto define(std::string_view name, uint32_t definition) -> void
+            {
+                visible[name].push_back({definition, stack.back().depth});
+                log.push_back(name);
+            }
+
+            [[nodiscard]] auto resolve(std::string_view name) const -> uint32_t
+            {
+                auto it = visible.find(name);
+                if (it == visible.end() || it->second.empty() || it->second.back().depth < stack.back().barrier)
+                {
+                    return no_local;
+                }
+                return it->second.back().definition;
+            }
+
+            [[nodiscard]] auto get_current_scope() const -> uint32_t
+            {
+                return stack.back().scope;
+            }
+
+            [[nodiscard]] auto get_depth() const -> size_t
+            {
+                return stack.size();
+            }
+
+        private:
+            struct frame
+            {
+                uint32_t scope;
+                uint32_t end;
+                uint32_t depth;
+                uint32_t barrier;
+                size_t log_mark;
+            };
+
+            struct binding
+            {
+                uint32_t definition;
+                uint32_t depth;
+            };
+
+            std::vector<frame> stack;
+            std::vector<std::string_view> log;
+            std::unordered_map<std::string_view, std::vector<binding>> visible;
+        };
+
+        // Runs the locals query over `range` and appends what it finds to
+        // `map`. When `skip_root_scope` is set, the scope capture spanning
+        // exactly `range` is the scope being rebuilt and is not re-added.
+        auto collect(scope_map &map,
+                     resolver &resolver,
+                     const tree &tree,
+                     std::string_view source,
+                     query_cursor &cursor,
+                     extent<uint32_t> range,
+                     bool skip_root_scope) const -> void
+        {
+            size_t keep = resolver.get_depth();
+            uint32_t last_definition_start = no_local;
+            uint32_t last_definition_end = no_local;
+
+            cursor.exec(locals, tree.get_root_node());
+            query_match match;
+            uint32_t position = 0;
+            while (cursor.next_capture(match, position))
+            {
+                role kind = roles[match.get_capture_id(position)];
+                if (kind == role::none)
+                {
+                    continue;
+                }
+                node node = match.get_capture_node(position);
+                extent<uint32_t> bytes = node.get_byte_range();
+                if (bytes.start < range.start || bytes.end > range.end ||
+                    !local_predicates.satisfies(match, source))
+                {
+                    continue;
+                }
+
+                resolver.leave_until(bytes.start, keep);
+                uint32_t scope = resolver.get_current_scope();
+
+                switch (kind)
+                {
+                case role::scope:
+                {
+                    if (skip_root_scope && bytes.start == range.start && bytes.end == range.end)
+                    {
+                        skip_root_scope = false;
+                        break;
+                    }
+                    std::optional<std::string_view> inherits =
+                        locals.get_property(match.get_pattern_index(), "local.scope-inherits");
+                    local_scope entry{bytes, scope, map.scopes[scope].depth + 1, !inherits || *inherits != "false"};
+                    map.scopes.push_back(entry);
+                    resolver.push(static_cast<uint32_t>(map.scopes.size() - 1), entry);
+                    break;
+                }
+                case role::definition:
+                    map.definitions.push_back({bytes, scope, match.get_capture_id(position)});
+                    resolver.define(node.get_source_range(source), static_cast<uint32_t>(map.definitions.size() - 1));
+                    last_definition_start = bytes.start;
+                    last_definition_end = bytes.end;
+                    break;
+                case role::reference:
+                    // A node captured as both a definition and a reference is
+                    // only a definition.
+                    if (bytes.start == last_definition_start && bytes.end == last_definition_end)
+                    {
+                        break;
+                    }
+                    map.references.push_back({bytes, scope, resolver.resolve(node.get_source_range(source))});
+                    break;
+                case role::none:
+                    break;
+                }
+            }
+        }
+
+        // Re-queries the contents of `target` and splices the result between
+        // the untouched entries before and after it.
+        auto rebuild(scope_map &map, uint32_t target, const tree &tree, std::string_view source, query_cursor &cursor)
+            const -> void
+        {
+            extent<uint32_t> range = map.scopes[target].bytes;
+
+            uint32_t scopes_end = target + 1;
+            while (scopes_end < map.scopes.size() && map.scopes[scopes_end].bytes.start < range.end)
+            {
+                ++scopes_end;
+            }
+            // Definitions and references are sorted by start byte, so the
+            // entries inside `target` are one contiguous run in each, even
+            // when it had none before the edit.
+            auto starts_before = [](const auto &entry, uint32_t byte) { return entry.bytes.start < byte; };
+            auto definitions_begin = static_cast<uint32_t>(
+                std::lower_bound(map.definitions.begin(), map.definitions.end(), range.start, starts_before) -
+                map.definitions.begin());
+            auto definitions_end = static_cast<uint32_t>(
+                std::lower_bound(map.definitions.begin() + definitions_begin, map.definitions.end(), range.end,
+                                 starts_before) -
+                map.definitions.begin());
+            auto references_begin = static_cast<uint32_t>(
+                std::lower_bound(map.references.begin(), map.references.end(), range.start, starts_before) -
+                map.references.begin());
+            auto references_end = static_cast<uint32_t>(
+                std::lower_bound(map.references.begin() + references_begin, map.references.end(), range.end,
+                                 starts_before) -
+                map.references.begin());
+
+            scope_map rebuilt;
+            rebuilt.scopes.assign(map.scopes.begin(), map.scopes.begin() + target + 1);
+            rebuilt.definitions.assign(map.definitions.begin(), map.definitions.begin() + definitions_begin);
+            rebuilt.references.assign(map.references.begin(), map.references.begin() + references_begin);
+
+            // Replay the enclosing scopes and the definitions they make
+            // visible before `target`, outermost first.
+            std::vector<uint32_t> chain;
+            for (uint32_t scope = target; scope != no_local; scope = map.scopes[scope].parent)
+            {
+                chain.push_back(scope);
+            }
+            resolver resolver;
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+            {
+                resolver.push(*it, map.scopes[*it]);
+                if (*it == target)
+                {
+                    break;
+                }
+                for (uint32_t definition = 0; definition < definitions_begin; ++definition)
+                {
+                    const local_definition &entry = map.definitions[definition];
+                    if (entry.scope == *it)
+                    {
+                        resolver.define(entry.bytes.start < source.size()
+                                            ? source.substr(entry.bytes.start, entry.bytes.end - entry.bytes.start)
+                                            : std::string_view{},
+                                        definition);
+                    }
+                }
+            }
+
+            cursor.set_byte_range(range);
+            collect(rebuilt, resolver, tree, source, cursor, range, true);
+            cursor.set_byte_range({0, std::numeric_limits<uint32_t>::max()});
+
+            // Entries after `target` keep their contents; only indices that
+            // point past the spliced region move.
+            auto new_scopes_end = static_cast<uint32_t>(rebuilt.scopes.size());
+            auto new_definitions_end = static_cast<uint32_t>(rebuilt.definitions.size());
+            auto remap_scope = [&](uint32_t scope)
+            { return scope == no_local || scope <= target ? scope : scope - scopes_end + new_scopes_end; };
+            auto remap_definition = [&](uint32_t definition)
+            {
+                return definition == no_local || definition < definitions_begin
+                           ? definition
+                           : definition - definitions_end + new_definitions_end;
+            };
+
+            for (uint32_t scope = scopes_end; scope < map.scopes.size(); ++scope)
+            {
+                local_scope entry = map.scopes[scope];
+                entry.parent = remap_scope(entry.parent);
+                rebuilt.scopes.push_back(entry);
+            }
+            for (uint32_t definition = definitions_end; definition < map.definitions.size(); ++definition)
+            {
+                local_definition entry = map.definitions[definition];
+                entry.scope = remap_scope(entry.scope);
+                rebuilt.definitions.push_back(entry);
+            }
+            for (uint32_t reference = references_end; reference < map.references.size(); ++reference)
+            {
+                local_reference entry = map.references[reference];
+                entry.scope = remap_scope(entry.scope);
+                entry.definition = remap_definition(entry.definition);
+                rebuilt.references.push_back(entry);
+            }
+            map = std::move(rebuilt);
+        }
+
+        // Moves every stored byte offset to where it lands after `edit`.
+        static auto shift(scope_map &map, const TSInputEdit &edit, uint32_t new_size) -> void
+        {
+            auto move = [&](uint32_t &byte)
+            {
+                if (byte >= edit.old_end_byte)
+                {
+                    byte = byte - edit.old_end_byte + edit.new_end_byte;
+                }
+                else if (byte > edit.start_byte)
+                {
+                    byte = edit.start_byte;
+                }
+            };
+            auto move_extent = [&](extent<uint32_t> &bytes)
+            {
+                move(bytes.start);
+                move(bytes.end);
+            };
+
+            for (local_scope &scope : map.scopes)
+            {
+                move_extent(scope.bytes);
+            }
+            for (local_definition &definition : map.definitions)
+            {
+                move_extent(definition.bytes);
+            }
+            for (local_reference &reference : map.references)
+            {
+                move_extent(reference.bytes);
+            }
+            map.scopes[0].bytes = {0, new_size};
+        }
+
+        query locals;
+        text_predicates local_predicates;
+        std::vector<role> roles;
+    };
+
+}
+
+#endif
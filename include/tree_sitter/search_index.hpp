@@ -0,0 +1,524 @@
+#ifndef CPP_TREE_SITTER_SEARCH_INDEX_H
+#define CPP_TREE_SITTER_SEARCH_INDEX_H
+
+#include <algorithm>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tree_sitter/batch.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/text_predicates.hpp"
+
+// A persistent code search index for a single language. Candidate files are
+// narrowed with trigram posting lists over the raw text plus per-file sets of
+// node types and identifier names taken from the syntax tree; the structural
+// query is then only run on the survivors.
+
+namespace ts
+{
+
+    using trigram = uint32_t;
+
+    // FNV-1a, used so identifier hashes stay stable across builds and the
+    // index can be written to disk.
+    [[nodiscard]] inline auto hash_identifier(std::string_view text) -> uint64_t
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (char c : text)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    // Returns the sorted, unique trigrams of `text`.
+    [[nodiscard]] inline auto get_trigrams(std::string_view text) -> std::vector<trigram>
+    {
+        std::vector<trigram> trigrams;
+        if (text.size() < 3)
+        {
+            return trigrams;
+        }
+        trigrams.reserve(text.size() - 2);
+        trigram window = (static_cast<unsigned char>(text[0]) << 8) | static_cast<unsigned char>(text[1]);
+        for (size_t i = 2; i < text.size(); ++i)
+        {
+            window = ((window << 8) | static_cast<unsigned char>(text[i])) & 0xffffff;
+            trigrams.push_back(window);
+        }
+        std::sort(trigrams.begin(), trigrams.end());
+        trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+        return trigrams;
+    }
+
+    struct search_request
+    {
+        // Substrings that must occur verbatim in the file.
+        std::vector<std::string> literals;
+        // Identifier names that must occur as identifier leaves.
+        std::vector<std::string> identifiers;
+        // Named node types that must occur somewhere in the tree.
+        std::vector<std::string> node_types;
+    };
+
+    struct search_hit
+    {
+        uint32_t document;
+        uint32_t pattern;
+        extent<uint32_t> bytes;
+        extent<point> points;
+    };
+
+    class search_index
+    {
+    public:
+        explicit search_index(language language)
+            : lang{language},
+              words_per_document{(language.get_num_symbols() + 63) / 64}
+        {
+        }
+
+        [[nodiscard]] auto get_language() const -> language
+        {
+            return lang;
+        }
+
+        [[nodiscard]] auto get_num_documents() const -> uint32_t
+        {
+            return static_cast<uint32_t>(documents.size());
+        }
+
+        [[nodiscard]] auto get_path(uint32_t document) const -> std::string_view
+        {
+            return documents[document].path;
+        }
+
+        // Adds a parsed file. Re-adding a path retires its previous entry;
+        // once most entries are retired the index is compacted, which
+        // renumbers documents.
+        auto add(std::string path, const tree &tree, std::string_view source) -> uint32_t
+        {
+            return insert(std::move(path), extract(tree, source));
+        }
+
+        // Parses and indexes files in parallel; extraction runs on the workers
+        // and only the posting-list merge is serialized.
+        auto add_files(std::span<const std::string> paths, std::span<const std::string_view> sources,
+                       unsigned threads = 0) -> void
+        {
+            std::mutex lock;
+            parse_each(
+                lang,
+                sources,
+                [&](const tree &tree, std::string_view source, size_t index, unsigned)
+                {
+                    extraction data = extract(tree, source);
+                    std::lock_guard guard{lock};
+                    insert(paths[index], std::move(data));
+                },
+                threads);
+        }
+
+        // Returns the live documents that could satisfy `request`, in
+        // ascending order.
+        [[nodiscard]] auto get_candidates(const search_request &request) const -> std::vector<uint32_t>
+        {
+            std::vector<trigram> required;
+            for (const std::string &literal : request.literals)
+            {
+                std::vector<trigram> trigrams = get_trigrams(literal);
+                required.insert(required.end(), trigrams.begin(), trigrams.end());
+            }
+            std::sort(required.begin(), required.end());
+            required.erase(std::unique(required.begin(), required.end()), required.end());
+
+            // Intersect the shortest lists first so the working set shrinks fast.
+            std::vector<const std::vector<uint32_t> *> lists;
+            for (trigram trigram : required)
+            {
+                auto it = postings.find(trigram);
+                if (it == postings.end())
+                {
+                    return {};
+                }
+                lists.push_back(&it->second);
+            }
+            std::sort(lists.begin(), lists.end(), [](auto *a, auto *b) { return a->size() < b->size(); });
+
+            std::vector<uint32_t> candidates;
+            if (lists.empty())
+            {
+                candidates.resize(documents.size());
+                for (uint32_t document = 0; document < documents.size(); ++document)
+                {
+                    candidates[document] = document;
+                }
+            }
+            else
+            {
+                candidates = *lists.front();
+                std::vector<uint32_t> scratch;
+                for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i)
+                {
+                    scratch.clear();
+                    std::set_intersection(candidates.begin(), candidates.end(),
+                                          lists[i]->begin(), lists[i]->end(),
+                                          std::back_inserter(scratch));
+                    candidates.swap(scratch);
+                }
+            }
+
+            std::vector<symbol> types;
+            for (const std::string &type : request.node_types)
+            {
+                // No node type has an empty name.
+                if (type.empty())
+                {
+                    return {};
+                }
+                symbol id = lang.get_symbol_for_name(type, true);
+                if (id == 0)
+                {
+                    return {};
+                }
+                types.push_back(id);
+            }
+            std::vector<uint64_t> names;
+            for (const std::string &identifier : request.identifiers)
+            {
+                names.push_back(hash_identifier(identifier));
+            }
+
+            std::erase_if(candidates,
+                          [&](uint32_t document)
+                          {
+                              const entry &doc = documents[document];
+                              if (!doc.live)
+                              {
+                                  return true;
+                              }
+                              for (symbol type : types)
+                              {
+                                  if (!(node_type_bits[document * words_per_document + type / 64] >> (type % 64) & 1))
+                                  {
+                                      return true;
+                                  }
+                              }
+                              for (uint64_t name : names)
+                              {
+                                  if (!std::binary_search(doc.identifiers.begin(), doc.identifiers.end(), name))
+                                  {
+                                      return true;
+                                  }
+                              }
+                              return false;
+                          });
+            return candidates;
+        }
+
+        // Runs `structural` over the candidates for `request`. `load(path)`
+        // must return the current source of a document and is called from
+        // worker threads. Each match yields one hit for its @match capture,
+        // or for its first capture if the query has no @match.
+        template <typename LoadFn>
+        auto search(const search_request &request, const query &structural, LoadFn &&load, unsigned threads = 0) const
+            -> std::vector<search_hit>
+        {
+            std::vector<uint32_t> candidates = get_candidates(request);
+            std::optional<uint32_t> match_capture = structural.get_capture_id("match");
+            const text_predicates predicates{structural};
+            unsigned num_workers = get_worker_count(candidates.size(), threads);
+            parser_pool parsers{num_workers};
+            std::vector<query_cursor> cursors(num_workers);
+            std::vector<std::vector<search_hit>> results(candidates.size());
+
+            parallel_for(
+                candidates.size(),
+                [&](size_t index, unsigned worker)
+                {
+                    uint32_t document = candidates[index];
+                    std::string source = load(documents[document].path);
+                    tree tree = parsers.get(worker, lang).parse_string(source);
+                    query_cursor &cursor = cursors[worker];
+                    cursor.exec(structural, tree.get_root_node());
+                    query_match match;
+                    while (cursor.next_match(match))
+                    {
+                        if (match.get_num_captures() == 0 || !predicates.satisfies(match, source))
+                        {
+                            continue;
+                        }
+                        node hit = match_capture ? match.find_capture(*match_capture) : match.get_capture_node(0);
+                        if (hit.is_null())
+                        {
+                            continue;
+                        }
+                        results[index].push_back(
+                            {document, match.get_pattern_index(), hit.get_byte_range(), hit.get_point_range()});
+                    }
+                },
+                num_workers);
+
+            std::vector<search_hit> hits;
+            for (std::vector<search_hit> &result : results)
+            {
+                hits.insert(hits.end(), result.begin(), result.end());
+            }
+            return hits;
+        }
+
+        // Drops retired entries and renumbers the live documents in their
+        // current order, so ids returned earlier no longer apply.
+        auto compact() -> void
+        {
+            if (num_retired == 0)
+            {
+                return;
+            }
+            constexpr uint32_t retired = std::numeric_limits<uint32_t>::max();
+            std::vector<uint32_t> renumbered(documents.size(), retired);
+            uint32_t next = 0;
+            for (uint32_t document = 0; document < documents.size(); ++document)
+            {
+                if (!documents[document].live)
+                {
+                    continue;
+                }
+                renumbered[document] = next;
+                if (next != document)
+                {
+                    documents[next] = std::move(documents[document]);
+                    std::copy_n(node_type_bits.begin() + document * words_per_document,
+                                words_per_document,
+                                node_type_bits.begin() + next * words_per_document);
+                }
+                ++next;
+            }
+            documents.resize(next);
+            node_type_bits.resize(next * words_per_document);
+
+            // Renumbering keeps the order, so the lists stay sorted.
+            for (auto it = postings.begin(); it != postings.end();)
+            {
+                std::vector<uint32_t> &list = it->second;
+                size_t kept = 0;
+                for (uint32_t document : list)
+                {
+                    if (renumbered[document] != retired)
+                    {
+                        list[kept++] = renumbered[document];
+                    }
+                }
+                list.resize(kept);
+                it = list.empty() ? postings.erase(it) : std::next(it);
+            }
+            for (auto &[path, document] : by_path)
+            {
+                document = renumbered[document];
+            }
+            num_retired = 0;
+        }
+
+        auto save(std::ostream &out) const -> void
+        {
+            write_value(out, magic);
+            write_value(out, static_cast<uint32_t>(lang.get_num_symbols()));
+            write_value(out, static_cast<uint32_t>(documents.size()));
+            for (const entry &doc : documents)
+            {
+                write_value(out, static_cast<uint8_t>(doc.live));
+                write_value(out, static_cast<uint32_t>(doc.path.size()));
+                out.write(doc.path.data(), static_cast<std::streamsize>(doc.path.size()));
+                write_array(out, doc.identifiers);
+            }
+            write_array(out, node_type_bits);
+            write_value(out, static_cast<uint32_t>(postings.size()));
+            for (const auto &[trigram, list] : postings)
+            {
+                write_value(out, trigram);
+                write_array(out, list);
+            }
+        }
+
+        // Returns false, leaving the index empty, if the stream does not hold
+        // an index for this language.
+        auto load(std::istream &in) -> bool
+        {
+            reset();
+
+            uint32_t file_magic = 0;
+            uint32_t num_symbols = 0;
+            uint32_t num_documents = 0;
+            if (!read_value(in, file_magic) || file_magic != magic || !read_value(in, num_symbols) ||
+                num_symbols != lang.get_num_symbols() || !read_value(in, num_documents))
+            {
+                return false;
+            }
+
+            documents.resize(num_documents);
+            for (uint32_t document = 0; document < num_documents; ++document)
+            {
+                entry &doc = documents[document];
+                uint8_t live = 0;
+                uint32_t length = 0;
+                if (!read_value(in, live) || !read_value(in, length))
+                {
+                    return reset();
+                }
+                doc.live = live != 0;
+                num_retired += doc.live ? 0 : 1;
+                doc.path.resize(length);
+                if (!in.read(doc.path.data(), length) || !read_array(in, doc.identifiers))
+                {
+                    return reset();
+                }
+                if (doc.live)
+                {
+                    by_path[doc.path] = document;
+                }
+            }
+
+            uint32_t num_lists = 0;
+            if (!read_array(in, node_type_bits) || !read_value(in, num_lists))
+            {
+                return reset();
+            }
+            for (uint32_t i = 0; i < num_lists; ++i)
+            {
+                trigram trigram = 0;
+                if (!read_value(in, trigram) || !read_array(in, postings[trigram]))
+                {
+                    return reset();
+                }
+            }
+            return true;
+        }
+
+    private:
+        static constexpr uint32_t magic = 0x58495354; // "TSIX"
+        static constexpr size_t min_retired_to_compact = 64;
+
+        struct entry
+        {
+            std::string path;
+            std::vector<uint64_t> identifiers;
+            bool live = true;
+        };
+
+        struct extraction
+        {
+            std::vector<trigram> trigrams;
+            std::vector<uint64_t> node_types;
+            std::vector<uint64_t> identifiers;
+        };
+
+        [[nodiscard]] auto extract(const tree &tree, std::string_view source) const -> extraction
+        {
+            extraction data{get_trigrams(source), std::vector<uint64_t>(words_per_document), {}};
+            visit(tree.get_root_node(),
+                  [&](node node)
+                  {
+                      symbol type = node.get_symbol();
+                      data.node_types[type / 64] |= uint64_t{1} << (type % 64);
+                      if (node.is_named() && node.get_num_children() == 0 &&
+                          node.get_type().find("identifier") != std::string_view::npos)
+                      {
+                          data.identifiers.push_back(hash_identifier(node.get_source_range(source)));
+                      }
+                  });
+            std::sort(data.identifiers.begin(), data.identifiers.end());
+            data.identifiers.erase(std::unique(data.identifiers.begin(), data.identifiers.end()),
+                                   data.identifiers.end());
+            return data;
+        }
+
+        auto insert(std::string path, extraction data) -> uint32_t
+        {
+            auto [it, inserted] = by_path.try_emplace(path, 0);
+            if (!inserted)
+            {
+                documents[it->second].live = false;
+                ++num_retired;
+                // Compacting only changes mapped values, so `it` stays valid.
+                if (num_retired >= min_retired_to_compact && num_retired * 2 > documents.size())
+                {
+                    compact();
+                }
+            }
+            auto document = static_cast<uint32_t>(documents.size());
+            it->second = document;
+
+            documents.push_back({std::move(path), std::move(data.identifiers), true});
+            node_type_bits.insert(node_type_bits.end(), data.node_types.begin(), data.node_types.end());
+            for (trigram trigram : data.trigrams)
+            {
+                postings[trigram].push_back(document);
+            }
+            return document;
+        }
+
+        auto reset() -> bool
+        {
+            num_retired = 0;
+            documents.clear();
+            node_type_bits.clear();
+            postings.clear();
+            by_path.clear();
+            return false;
+        }
+
+        template <typename T>
+        static auto write_value(std::ostream &out, T value) -> void
+        {
+            out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        static auto write_array(std::ostream &out, const std::vector<T> &values) -> void
+        {
+            write_value(out, static_cast<uint32_t>(values.size()));
+            out.write(reinterpret_cast<const char *>(values.data()),
+                      static_cast<std::streamsize>(values.size() * sizeof(T)));
+        }
+
+        template <typename T>
+        static auto read_value(std::istream &in, T &value) -> bool
+        {
+            return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+        }
+
+        template <typename T>
+        static auto read_array(std::istream &in, std::vector<T> &values) -> bool
+        {
+            uint32_t size = 0;
+            if (!read_value(in, size))
+            {
+                return false;
+            }
+            values.resize(size);
+            return static_cast<bool>(
+                in.read(reinterpret_cast<char *>(values.data()), static_cast<std::streamsize>(size * sizeof(T))));
+        }
+
+        language lang;
+        size_t words_per_document;
+        std::vector<entry> documents;
+        // One bitset of present node types per document, words_per_document
+        // words each.
+        std::vector<uint64_t> node_type_bits;
+        std::unordered_map<trigram, std::vector<uint32_t>> postings;
+        std::unordered_map<std::string, uint32_t> by_path;
+        size_t num_retired = 0;
+    };
+
+}
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef CPP_TREE_SITTER_SECRETS_H
+#define CPP_TREE_SITTER_SECRETS_H
+
+#include <array>
+#include <memory>
+#include <regex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "tree_sitter/batch.hpp"
+#include "tree_sitter/bundled.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+
+// Secret scanning restricted to string literals and, optionally, comments.
+// Only those byte ranges are searched: each rule's required literal is looked
+// for first with a plain substring search, and the rule's regex only runs on
+// the literals that contain it. Code outside literals is never scanned, which
+// removes most false positives along with most of the bytes.
+
+namespace ts
+{
+
+    struct secret_rule
+    {
+        std::string name;
+        // A substring every match must contain, or empty to always run the
+        // pattern.
+        std::string literal;
+        // ECMAScript regular expression.
+        std::string pattern;
+    };
+
+    struct secret_finding
+    {
+        // Index of the rule that matched.
+        uint32_t rule;
+        extent<uint32_t> bytes;
+        // The literal or comment containing the match.
+        extent<uint32_t> node_bytes;
+    };
+
+    // A small set of well-known credential formats.
+    [[nodiscard]] inline auto get_default_secret_rules() -> std::vector<secret_rule>
+    {
+        return {
+            {"aws-access-key-id", "AKIA", "AKIA[0-9A-Z]{16}"},
+            {"github-token", "gh", "gh[pousr]_[A-Za-z0-9]{36,}"},
+            {"slack-token", "xox", "xox[abposr]-[A-Za-z0-9-]{10,}"},
+            {"google-api-key", "AIza", "AIza[0-9A-Za-z_-]{35}"},
+            {"stripe-secret-key", "sk_live_", "sk_live_[0-9A-Za-z]{24,}"},
+            {"private-key", "-----BEGIN", "-----BEGIN [A-Z ]*PRIVATE KEY-----"},
+        };
+    }
+
+    class secret_scanner
+    {
+    public:
+        // Throws std::regex_error if a pattern does not compile.
+        secret_scanner(language language, std::vector<secret_rule> rules, bool include_comments = false)
+            : rules{std::move(rules)},
+              scanned(language.get_num_symbols(), false)
+        {
+            for (const secret_rule &rule : this->rules)
+            {
+                patterns.emplace_back(rule.pattern, std::regex::ECMAScript | std::regex::optimize);
+            }
+            for (symbol id = 0; id < scanned.size(); ++id)
+            {
+                scanned[id] = is_literal_symbol(language, id) || (include_comments && is_comment_symbol(language, id));
+            }
+        }
+
+        auto scan(const tree &tree, std::string_view source, std::vector<secret_finding> &findings) const -> void
+        {
+            visit(tree.get_root_node(),
+                  [&](node node) -> bool
+                  {
+                      symbol id = node.get_symbol();
+                      if (id >= scanned.size() || !scanned[id])
+                      {
+                          return true;
+                      }
+                      scan_range(source, node.get_byte_range(), findings);
+                      return false;
+                  });
+        }
+
+        [[nodiscard]] auto scan(const tree &tree, std::string_view source) const -> std::vector<secret_finding>
+        {
+            std::vector<secret_finding> findings;
+            scan(tree, source, findings);
+            return findings;
+        }
+
+        [[nodiscard]] auto get_rules() const -> const std::vector<secret_rule> &
+        {
+            return rules;
+        }
+
+    private:
+        auto scan_range(std::string_view source, extent<uint32_t> bytes, std::vector<secret_finding> &findings) const
+            -> void
+        {
+            std::string_view text = source.substr(bytes.start, bytes.end - bytes.start);
+            for (uint32_t rule = 0; rule < rules.size(); ++rule)
+            {
+                if (!rules[rule].literal.empty() && text.find(rules[rule].literal) == std::string_view::npos)
+                {
+                    continue;
+                }
+                for (std::cregex_iterator it{text.data(), text.data() + text.size(), patterns[rule]}, end; it != end;
+                     ++it)
+                {
+                    auto start = bytes.start + static_cast<uint32_t>(it->position());
+                    findings.push_back({rule, {start, start + static_cast<uint32_t>(it->length())}, bytes});
+                }
+            }
+        }
+
+        std::vector<secret_rule> rules;
+        std::vector<std::regex> patterns;
+        // Whether nodes of a symbol are searched rather than descended into.
+        std::vector<bool> scanned;
+    };
+
+    // Scans every file in parallel; the findings for files[i] are element i.
+    [[nodiscard]] inline auto scan_sources(std::span<const source_file> files,
+                                           const std::vector<secret_rule> &rules,
+                                           bool include_comments = false,
+                                           unsigned threads = 0) -> std::vector<std::vector<secret_finding>>
+    {
+        std::array<std::unique_ptr<secret_scanner>, std::size(bundled_languages)> scanners;
+        for (const source_file &file : files)
+        {
+            auto &slot = scanners[static_cast<size_t>(file.language)];
+            if (!slot)
+            {
+                slot = std::make_unique<secret_scanner>(get_language(file.language), rules, include_comments);
+            }
+        }
+
+        std::vector<std::vector<secret_finding>> results(files.size());
+        unsigned num_workers = get_worker_count(files.size(), threads);
+        parser_pool parsers{num_workers};
+        parallel_for(
+            files.size(),
+            [&](size_t index, unsigned worker)
+            {
+                const source_file &file = files[index];
+                tree tree = parsers.get(worker, get_language(file.language)).parse_string(file.text);
+                scanners[static_cast<size_t>(file.language)]->scan(tree, file.text, results[index]);
+            },
+            num_workers);
+        return results;
+    }
+
+}
+
+#endif
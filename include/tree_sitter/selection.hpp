@@ -0,0 +1,115 @@
+#ifndef CPP_TREE_SITTER_SELECTION_H
+#define CPP_TREE_SITTER_SELECTION_H
+
+#include <algorithm>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include "tree_sitter/cpp-tree-sitter.hpp"
+
+// Selection-range chains (LSP's textDocument/selectionRange) for a batch of
+// positions. Positions are visited in sorted order with one node_path and one
+// cursor: moving to the next position only climbs to the deepest ancestor it
+// shares with the previous one and descends from there, so a batch costs one
+// partial walk of the tree rather than a descent from the root per position.
+
+namespace ts
+{
+
+    struct selection_ranges
+    {
+        // The chain of position i is ranges[offsets[i]] to
+        // ranges[offsets[i + 1] - 1], innermost first and ending at the root.
+        // Nodes sharing the range of the one below them are left out.
+        std::vector<extent<uint32_t>> ranges;
+        std::vector<uint32_t> offsets;
+    };
+
+    // Fills `result` with the chain of every byte offset in `positions`.
+    inline auto get_selection_ranges(const tree &tree,
+                                     std::span<const uint32_t> positions,
+                                     selection_ranges &result) -> void
+    {
+        std::vector<uint32_t> order(positions.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(),
+                         order.end(),
+                         [&](uint32_t a, uint32_t b) { return positions[a] < positions[b]; });
+
+        // Chains in sorted order first, then laid out by position.
+        std::vector<extent<uint32_t>> sorted_ranges;
+        std::vector<uint32_t> sorted_offsets;
+        sorted_offsets.reserve(positions.size() + 1);
+
+        node root = tree.get_root_node();
+        node_path path{root};
+        cursor cursor = root.get_cursor();
+        for (uint32_t index : order)
+        {
+            uint32_t byte = positions[index];
+            auto contains = [&](node node)
+            {
+                extent<uint32_t> bytes = node.get_byte_range();
+                return bytes.start <= byte && byte < bytes.end;
+            };
+            while (path.get_depth() > 0 && !contains(path.get_node()))
+            {
+                path.pop();
+            }
+            cursor.reset(path.get_node());
+            for (int64_t child = cursor.goto_first_child_for_byte(byte); child >= 0;
+                 child = cursor.goto_first_child_for_byte(byte))
+            {
+                node node = cursor.get_current_node();
+                if (!contains(node))
+                {
+                    break;
+                }
+                path.push_child(node, static_cast<uint32_t>(child));
+            }
+
+            sorted_offsets.push_back(static_cast<uint32_t>(sorted_ranges.size()));
+            for (size_t level = 0; level <= path.get_depth(); ++level)
+            {
+                extent<uint32_t> bytes = path.get_ancestor(level).get_byte_range();
+                size_t begin = sorted_offsets.back();
+                if (sorted_ranges.size() == begin || sorted_ranges.back().start != bytes.start ||
+                    sorted_ranges.back().end != bytes.end)
+                {
+                    sorted_ranges.push_back(bytes);
+                }
+            }
+        }
+        sorted_offsets.push_back(static_cast<uint32_t>(sorted_ranges.size()));
+
+        result.ranges.clear();
+        result.ranges.reserve(sorted_ranges.size());
+        result.offsets.assign(positions.size() + 1, 0);
+        std::vector<uint32_t> slot(positions.size());
+        for (uint32_t rank = 0; rank < order.size(); ++rank)
+        {
+            slot[order[rank]] = rank;
+        }
+        for (uint32_t index = 0; index < positions.size(); ++index)
+        {
+            uint32_t rank = slot[index];
+            result.offsets[index] = static_cast<uint32_t>(result.ranges.size());
+            result.ranges.insert(result.ranges.end(),
+                                 sorted_ranges.begin() + sorted_offsets[rank],
+                                 sorted_ranges.begin() + sorted_offsets[rank + 1]);
+        }
+        result.offsets[positions.size()] = static_cast<uint32_t>(result.ranges.size());
+    }
+
+    [[nodiscard]] inline auto get_selection_ranges(const tree &tree, std::span<const uint32_t> positions)
+        -> selection_ranges
+    {
+        selection_ranges result;
+        get_selection_ranges(tree, positions, result);
+        return result;
+    }
+
+}
+
+#endif
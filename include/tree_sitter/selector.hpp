@@ -0,0 +1,312 @@
+#ifndef CPP_TREE_SITTER_SELECTOR_H
+#define CPP_TREE_SITTER_SELECTOR_H
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/flat_tree.hpp"
+#include "tree_sitter/symbol_index.hpp"
+
+// CSS-style selectors over syntax trees, for example
+//
+//     function_definition > compound_statement call_expression[function=identifier]
+//
+// Supported syntax: node types (named nodes only) or `*`; `[field]` for a
+// child in that field and `[field=type]` for one of that type; descendant
+// (whitespace) and child (`>`) combinators; and `,` between alternatives.
+//
+// Selectors are matched right to left: the candidates for the rightmost step
+// come from the posting lists of a symbol_index, and the remaining steps are
+// checked by climbing the flat_tree's parent array.
+
+namespace ts
+{
+
+    class selector
+    {
+    public:
+        // Throws query_error if the selector does not parse or names a type
+        // or field the language does not have.
+        selector(language language, std::string_view source)
+            : grammar{language},
+              source{source}
+        {
+            do
+            {
+                alternatives.push_back(parse_alternative());
+            } while (consume(','));
+            this->source = {};
+        }
+
+        // Appends the positions of all matching nodes, in document order.
+        auto select(const flat_tree &tree, const symbol_index &index, std::vector<node_position> &results) const
+            -> void
+        {
+            size_t first = results.size();
+            bool sorted = alternatives.size() == 1;
+            for (const std::vector<step> &steps : alternatives)
+            {
+                const step &last = steps.back();
+                if (last.any)
+                {
+                    for (node_position position = 0; position < tree.size(); ++position)
+                    {
+                        if (matches(tree, steps, steps.size() - 1, position))
+                        {
+                            results.push_back(position);
+                        }
+                    }
+                    continue;
+                }
+                sorted = sorted && last.symbols.size() == 1;
+                for (symbol symbol : last.symbols)
+                {
+                    for (node_position position : index.get_positions(symbol))
+                    {
+                        if (matches(tree, steps, steps.size() - 1, position))
+                        {
+                            results.push_back(position);
+                        }
+                    }
+                }
+            }
+            if (!sorted)
+            {
+                std::sort(results.begin() + static_cast<std::ptrdiff_t>(first), results.end());
+                results.erase(std::unique(results.begin() + static_cast<std::ptrdiff_t>(first), results.end()),
+                              results.end());
+            }
+        }
+
+        [[nodiscard]] auto select(const flat_tree &tree, const symbol_index &index) const -> std::vector<node_position>
+        {
+            std::vector<node_position> results;
+            select(tree, index, results);
+            return results;
+        }
+
+        [[nodiscard]] auto matches(const flat_tree &tree, node_position position) const -> bool
+        {
+            return std::any_of(alternatives.begin(),
+                               alternatives.end(),
+                               [&](const std::vector<step> &steps)
+                               { return matches(tree, steps, steps.size() - 1, position); });
+        }
+
+    private:
+        struct attribute
+        {
+            field_id field;
+            // Empty if any child in the field will do.
+            std::vector<symbol> symbols;
+        };
+
+        struct step
+        {
+            bool any = false;
+            std::vector<symbol> symbols;
+            std::vector<attribute> attributes;
+            // Whether this step must be the parent of the next one, rather
+            // than any ancestor.
+            bool is_parent = false;
+        };
+
+        [[nodiscard]] static auto has_symbol(const std::vector<symbol> &symbols, symbol symbol) -> bool
+        {
+            return std::find(symbols.begin(), symbols.end(), symbol) != symbols.end();
+        }
+
+        [[nodiscard]] static auto matches_step(const flat_tree &tree, const step &step, node_position position) -> bool
+        {
+            if (step.any ? !tree.is_named(position) : !has_symbol(step.symbols, tree.get_symbol(position)))
+            {
+                return false;
+            }
+            for (const attribute &attribute : step.attributes)
+            {
+                bool found = false;
+                for (node_position child = tree.get_first_child(position); child != no_position && !found;
+                     child = tree.get_next_sibling(child))
+                {
+                    found = tree.get_field_id(child) == attribute.field &&
+                            (attribute.symbols.empty() || has_symbol(attribute.symbols, tree.get_symbol(child)));
+                }
+                if (!found)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        [[nodiscard]] static auto matches(const flat_tree &tree,
+                                          const std::vector<step> &steps,
+                                          size_t current,
+                                          node_position position) -> bool
+        {
+            if (!matches_step(tree, steps[current], position))
+            {
+                return false;
+            }
+            if (current == 0)
+            {
+                return true;
+            }
+            const step &previous = steps[current - 1];
+            for (node_position ancestor = tree.get_parent(position); ancestor != no_position;
+                 ancestor = tree.get_parent(ancestor))
+            {
+                if (matches(tree, steps, current - 1, ancestor))
+                {
+                    return true;
+                }
+                if (previous.is_parent)
+                {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        // Parsing
+
+        [[noreturn]] auto fail(TSQueryError type, const std::string &message) const -> void
+        {
+            throw query_error{static_cast<uint32_t>(offset), type, message + " at offset " + std::to_string(offset)};
+        }
+
+        auto skip_space() -> bool
+        {
+            size_t start = offset;
+            while (offset < source.size() && (source[offset] == ' ' || source[offset] == '\t' ||
+                                              source[offset] == '\n' || source[offset] == '\r'))
+            {
+                ++offset;
+            }
+            return offset != start;
+        }
+
+        auto consume(char c) -> bool
+        {
+            skip_space();
+            if (offset < source.size() && source[offset] == c)
+            {
+                ++offset;
+                return true;
+            }
+            return false;
+        }
+
+        [[nodiscard]] auto parse_name() -> std::string_view
+        {
+            size_t start = offset;
+            while (offset < source.size() && (std::isalnum(static_cast<unsigned char>(source[offset])) ||
+                                              source[offset] == '_'))
+            {
+                ++offset;
+            }
+            if (offset == start)
+            {
+                fail(TSQueryErrorSyntax, "expected a name");
+            }
+            return source.substr(start, offset - start);
+        }
+
+        [[nodiscard]] auto parse_type() -> std::vector<symbol>
+        {
+            size_t start = offset;
+            std::string_view name = parse_name();
+            std::vector<symbol> symbols;
+            for (symbol id = 0; id < grammar.get_num_symbols(); ++id)
+            {
+                if (grammar.get_symbol_type(id) == TSSymbolTypeRegular && grammar.get_symbol_name(id) == name)
+                {
+                    symbols.push_back(id);
+                }
+            }
+            if (symbols.empty())
+            {
+                offset = start;
+                fail(TSQueryErrorNodeType, "unknown node type '" + std::string{name} + "'");
+            }
+            return symbols;
+        }
+
+        [[nodiscard]] auto parse_step() -> step
+        {
+            step step;
+            skip_space();
+            if (offset < source.size() && source[offset] == '*')
+            {
+                step.any = true;
+                ++offset;
+            }
+            else
+            {
+                step.symbols = parse_type();
+            }
+
+            while (offset < source.size() && source[offset] == '[')
+            {
+                ++offset;
+                skip_space();
+                size_t start = offset;
+                std::string_view name = parse_name();
+                attribute attribute{grammar.get_field_id_for_name(name), {}};
+                if (attribute.field == 0)
+                {
+                    offset = start;
+                    fail(TSQueryErrorField, "unknown field '" + std::string{name} + "'");
+                }
+                if (consume('='))
+                {
+                    skip_space();
+                    attribute.symbols = parse_type();
+                }
+                if (!consume(']'))
+                {
+                    fail(TSQueryErrorSyntax, "expected ']'");
+                }
+                step.attributes.push_back(std::move(attribute));
+            }
+            return step;
+        }
+
+        [[nodiscard]] auto parse_alternative() -> std::vector<step>
+        {
+            std::vector<step> steps;
+            steps.push_back(parse_step());
+            for (;;)
+            {
+                bool spaced = skip_space();
+                if (offset == source.size() || source[offset] == ',')
+                {
+                    return steps;
+                }
+                if (source[offset] == '>')
+                {
+                    ++offset;
+                    steps.back().is_parent = true;
+                }
+                else if (!spaced)
+                {
+                    fail(TSQueryErrorSyntax, "unexpected '" + std::string{source[offset]} + "'");
+                }
+                steps.push_back(parse_step());
+            }
+        }
+
+        language grammar;
+        // Only set while parsing.
+        std::string_view source;
+        size_t offset = 0;
+        std::vector<std::vector<step>> alternatives;
+    };
+
+}
+
+#endif
@@ -0,0 +1,385 @@
+#ifndef CPP_TREE_SITTER_SEMANTIC_TOKENS_H
+#define CPP_TREE_SITTER_SEMANTIC_TOKENS_H
+
+#include <algorithm>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/text_predicates.hpp"
+
+// LSP semantic tokens from a grammar's `highlights.scm`. Captures are
+// flattened into non-overlapping single-line tokens (an inner capture splits
+// the one around it; of several captures on the same node the first wins)
+// and encoded as LSP's relative integer arrays.
+//
+// A capture name maps to a token type through its dot-separated components,
+// last first: @function.method is a method, @variable.parameter a parameter.
+// Components naming a modifier set its bit. Captures with no type, such as
+// @punctuation.bracket under the default legend, produce no tokens.
+//
+// Because tokens are encoded relative to the previous one, an edit only
+// changes the encoding of the tokens on the lines it touches and of the first
+// token after them; update() re-queries just those lines and returns the
+// corresponding semanticTokens/full/delta edit.
+
+namespace ts
+{
+
+    // How columns and lengths are counted: UTF-8 bytes or UTF-16 code units,
+    // LSP's default.
+    enum class position_encoding : uint8_t
+    {
+        utf8,
+        utf16,
+    };
+
+    // Number of `encoding` units in `text`.
+    [[nodiscard]] inline auto get_width(std::string_view text, position_encoding encoding) -> uint32_t
+    {
+        if (encoding == position_encoding::utf8)
+        {
+            return static_cast<uint32_t>(text.size());
+        }
+        uint32_t width = 0;
+        for (char c : text)
+        {
+            auto byte = static_cast<unsigned char>(c);
+            // Every lead byte starts a code unit; four-byte sequences are
+            // surrogate pairs.
+            width += (byte & 0xC0) != 0x80 ? 1 : 0;
+            width += byte >= 0xF0 ? 1 : 0;
+        }
+        return width;
+    }
+
+    struct semantic_legend
+    {
+        std::vector<std::string> token_types;
+        std::vector<std::string> token_modifiers;
+    };
+
+    // The token types and modifiers predefined by LSP.
+    [[nodiscard]] inline auto get_default_semantic_legend() -> semantic_legend
+    {
+        return {{"namespace", "type", "class", "enum", "interface", "struct", "typeParameter", "parameter",
+                 "variable", "property", "enumMember", "event", "function", "method", "macro", "keyword",
+                 "modifier", "comment", "string", "number", "regexp", "operator", "decorator"},
+                {"declaration", "definition", "readonly", "static", "deprecated", "abstract", "async",
+                 "modification", "documentation", "defaultLibrary"}};
+    }
+
+    struct semantic_token
+    {
+        uint32_t start_byte;
+        uint32_t line;
+        uint32_t column;
+        uint32_t length;
+        uint32_t type;
+        uint32_t modifiers;
+    };
+
+    // One edit of a semanticTokens/full/delta response: replace
+    // `delete_count` integers of the previous array at `start` with `data`.
+    struct semantic_tokens_edit
+    {
+        uint32_t start;
+        uint32_t delete_count;
+        std::vector<uint32_t> data;
+    };
+
+    // Appends the relative encoding of `tokens` to `data`. `previous` is the
+    // token before tokens.front(), if any.
+    inline auto encode_semantic_tokens(std::span<const semantic_token> tokens,
+                                       std::vector<uint32_t> &data,
+                                       const semantic_token *previous = nullptr) -> void
+    {
+        data.reserve(data.size() + tokens.size() * 5);
+        uint32_t line = previous ? previous->line : 0;
+        uint32_t column = previous ? previous->column : 0;
+        for (const semantic_token &token : tokens)
+        {
+            data.push_back(token.line - line);
+            data.push_back(token.line == line ? token.column - column : token.column);
+            data.push_back(token.length);
+            data.push_back(token.type);
+            data.push_back(token.modifiers);
+            line = token.line;
+            column = token.column;
+        }
+    }
+
+    class semantic_tokenizer
+    {
+    public:
+        // Throws query_error if `highlights_query` does not compile.
+        semantic_tokenizer(language language,
+                           std::string_view highlights_query,
+                           semantic_legend legend = get_default_semantic_legend(),
+                           position_encoding encoding = position_encoding::utf16)
+            : highlights{language, highlights_query},
+              highlight_predicates{highlights},
+              legend{std::move(legend)},
+              encoding{encoding}
+        {
+            // Common highlight names with a different name in LSP.
+            static constexpr std::pair<std::string_view, std::string_view> type_aliases[] = {
+                {"attribute", "decorator"},
+                {"constant", "variable"},
+                {"constructor", "class"},
+            };
+            static constexpr std::pair<std::string_view, std::string_view> modifier_aliases[] = {
+                {"builtin", "defaultLibrary"},
+                {"constant", "readonly"},
+            };
+            auto find = [](const std::vector<std::string> &names, std::string_view name)
+            {
+                return static_cast<uint32_t>(std::find(names.begin(), names.end(), name) - names.begin());
+            };
+
+            for (uint32_t id = 0; id < highlights.get_num_captures(); ++id)
+            {
+                std::string_view name = highlights.get_capture_name(id);
+                token_style style{no_type, 0};
+                while (!name.empty())
+                {
+                    size_t dot = name.find_last_of('.');
+                    std::string_view component = dot == std::string_view::npos ? name : name.substr(dot + 1);
+                    name = dot == std::string_view::npos ? std::string_view{} : name.substr(0, dot);
+
+                    std::string_view type_name = component;
+                    std::string_view modifier_name = component;
+                    for (const auto &[from, to] : type_aliases)
+                    {
+                        type_name = component == from ? to : type_name;
+                    }
+                    for (const auto &[from, to] : modifier_aliases)
+                    {
+                        modifier_name = component == from ? to : modifier_name;
+                    }
+                    uint32_t type = find(this->legend.token_types, type_name);
+                    if (style.type == no_type && type < this->legend.token_types.size())
+                    {
+                        style.type = type;
+                    }
+                    uint32_t modifier = find(this->legend.token_modifiers, modifier_name);
+                    if (modifier < this->legend.token_modifiers.size() && modifier < 32)
+                    {
+                        style.modifiers |= 1u << modifier;
+                    }
+                }
+                styles.push_back(style);
+            }
+        }
+
+        [[nodiscard]] auto get_legend() const -> const semantic_legend &
+        {
+            return legend;
+        }
+
+        [[nodiscard]] auto get_encoding() const -> position_encoding
+        {
+            return encoding;
+        }
+
+        auto tokenize(const tree &tree,
+                      std::string_view source,
+                      query_cursor &cursor,
+                      std::vector<semantic_token> &tokens) const -> void
+        {
+            tokens.clear();
+            collect(tree, source, cursor, {0, static_cast<uint32_t>(source.size())}, 0, tokens);
+        }
+
+        [[nodiscard]] auto tokenize(const tree &tree, std::string_view source, query_cursor &cursor) const
+            -> std::vector<semantic_token>
+        {
+            std::vector<semantic_token> tokens;
+            tokenize(tree, source, cursor, tokens);
+            return tokens;
+        }
+
+        // Brings `tokens` up to date after `edit` and returns the edit that
+        // turns the encoding of the old tokens into that of the new ones.
+        // `old_tree` is the previous tree after tree::edit, and `new_tree`
+        // was reparsed from it.
+        [[nodiscard]] auto update(std::vector<semantic_token> &tokens,
+                                  const TSInputEdit &edit,
+                                  const tree &old_tree,
+                                  const tree &new_tree,
+                                  std::string_view new_source,
+                                  query_cursor &cursor) const -> semantic_tokens_edit
+        {
+            // Tokens after the edit move by whole lines: anything on the
+            // line the edit ends on is re-queried below.
+            auto row_delta = static_cast<int64_t>(edit.new_end_point.row) - edit.old_end_point.row;
+            for (semantic_token &token : tokens)
+            {
+                if (token.start_byte >= edit.old_end_byte)
+                {
+                    token.start_byte = token.start_byte - edit.old_end_byte + edit.new_end_byte;
+                    token.line = static_cast<uint32_t>(token.line + row_delta);
+                }
+                else if (token.start_byte > edit.start_byte)
+                {
+                    token.start_byte = edit.start_byte;
+                }
+            }
+
+            // The lines touched by the edit or by a change in structure.
+            uint32_t start = edit.start_byte;
+            uint32_t start_row = edit.start_point.row;
+            uint32_t end = edit.new_end_byte;
+            for (const TSRange &range : old_tree.get_changed_ranges(new_tree))
+            {
+                if (range.start_byte < start)
+                {
+                    start = range.start_byte;
+                    start_row = range.start_point.row;
+                }
+                end = std::max(end, range.end_byte);
+            }
+            auto size = static_cast<uint32_t>(new_source.size());
+            start = std::min(start, size);
+            end = std::min(end, size);
+            size_t line_start = start > 0 ? new_source.rfind('\n', start - 1) : std::string_view::npos;
+            start = line_start == std::string_view::npos ? 0 : static_cast<uint32_t>(line_start + 1);
+            size_t line_end = new_source.find('\n', end);
+            end = line_end == std::string_view::npos ? size : static_cast<uint32_t>(line_end + 1);
+
+            auto by_start = [](const semantic_token &token, uint32_t byte) { return token.start_byte < byte; };
+            auto first = std::lower_bound(tokens.begin(), tokens.end(), start, by_start);
+            auto last = std::lower_bound(first, tokens.end(), end, by_start);
+
+            std::vector<semantic_token> fresh;
+            collect(new_tree, new_source, cursor, {start, end}, start_row, fresh);
+            cursor.set_byte_range({0, std::numeric_limits<uint32_t>::max()});
+
+            auto index = static_cast<uint32_t>(first - tokens.begin());
+            auto removed = static_cast<uint32_t>(last - first);
+            bool has_next = last != tokens.end();
+            first = tokens.erase(first, last);
+            tokens.insert(first, fresh.begin(), fresh.end());
+
+            semantic_tokens_edit result{index * 5, (removed + (has_next ? 1 : 0)) * 5, {}};
+            auto count = fresh.size() + (has_next ? 1 : 0);
+            encode_semantic_tokens(std::span{tokens}.subspan(index, count),
+                                   result.data,
+                                   index > 0 ? &tokens[index - 1] : nullptr);
+            return result;
+        }
+
+    private:
+        static constexpr uint32_t no_type = std::numeric_limits<uint32_t>::max();
+
+        struct token_style
+        {
+            uint32_t type;
+            uint32_t modifiers;
+        };
+
+        // Appends the tokens within `range`, which starts a line numbered
+        // `row`.
+        auto collect(const tree &tree,
+                     std::string_view source,
+                     query_cursor &cursor,
+                     extent<uint32_t> range,
+                     uint32_t row,
+                     std::vector<semantic_token> &tokens) const -> void
+        {
+            uint32_t byte = range.start;
+            uint32_t column = 0;
+            // Emits [from, to) as one token per line.
+            auto emit = [&](uint32_t from, uint32_t to, token_style style)
+            {
+                from = std::max(from, range.start);
+                to = std::min(to, range.end);
+                while (from < to)
+                {
+                    size_t newline = source.find('\n', byte);
+                    if (newline != std::string_view::npos && newline < from)
+                    {
+                        row += 1;
+                        column = 0;
+                        byte = static_cast<uint32_t>(newline + 1);
+                        continue;
+                    }
+                    column += get_width(source.substr(byte, from - byte), encoding);
+                    byte = from;
+                    auto piece_end = static_cast<uint32_t>(std::min<size_t>(newline, to));
+                    uint32_t length = get_width(source.substr(from, piece_end - from), encoding);
+                    if (length > 0)
+                    {
+                        tokens.push_back({from, row, column, length, style.type, style.modifiers});
+                    }
+                    column += length;
+                    byte = piece_end;
+                    from = piece_end < to ? piece_end + 1 : to;
+                }
+            };
+
+            struct open_capture
+            {
+                uint32_t end;
+                token_style style;
+            };
+            std::vector<open_capture> stack;
+            uint32_t position = range.start;
+            extent<uint32_t> last_bytes{0, 0};
+
+            cursor.set_byte_range(range);
+            cursor.exec(highlights, tree.get_root_node());
+            query_match match;
+            uint32_t capture = 0;
+            while (cursor.next_capture(match, capture))
+            {
+                token_style style = styles[match.get_capture_id(capture)];
+                extent<uint32_t> bytes = match.get_capture_node(capture).get_byte_range();
+                if (style.type == no_type || (bytes.start == last_bytes.start && bytes.end == last_bytes.end) ||
+                    !highlight_predicates.satisfies(match, source))
+                {
+                    continue;
+                }
+                last_bytes = bytes;
+
+                while (!stack.empty() && stack.back().end <= bytes.start)
+                {
+                    emit(position, stack.back().end, stack.back().style);
+                    position = std::max(position, stack.back().end);
+                    stack.pop_back();
+                }
+                if (!stack.empty())
+                {
+                    emit(position, bytes.start, stack.back().style);
+                    // A capture that overlaps the one around it without
+                    // nesting is cut short.
+                    bytes.end = std::min(bytes.end, stack.back().end);
+                }
+                position = std::max(position, bytes.start);
+                if (bytes.end > position)
+                {
+                    stack.push_back({bytes.end, style});
+                }
+            }
+            while (!stack.empty())
+            {
+                emit(position, stack.back().end, stack.back().style);
+                position = std::max(position, stack.back().end);
+                stack.pop_back();
+            }
+        }
+
+        query highlights;
+        text_predicates highlight_predicates;
+        semantic_legend legend;
+        position_encoding encoding;
+        std::vector<token_style> styles;
+    };
+
+}
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef CPP_TREE_SITTER_STRIP_H
+#define CPP_TREE_SITTER_STRIP_H
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tree_sitter/batch.hpp"
+#include "tree_sitter/bundled.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+
+// Re-emits source with comments removed and the whitespace between tokens
+// collapsed, for clone detection and dataset preprocessing. Tokens are copied
+// in one walk over the leaves; string and character literals are copied whole
+// so their contents are never touched, as is any other text a grammar keeps
+// in hidden tokens between visible children.
+
+namespace ts
+{
+
+    struct strip_options
+    {
+        // Keep line breaks (collapsing blank lines) and the indentation of
+        // each line, which indentation-sensitive grammars such as Python need.
+        // Otherwise any whitespace between tokens becomes a single space.
+        bool keep_lines = false;
+    };
+
+    class source_stripper
+    {
+    public:
+        explicit source_stripper(language language, strip_options options = {})
+            : roles(language.get_num_symbols(), role::other),
+              options{options}
+        {
+            for (symbol id = 0; id < roles.size(); ++id)
+            {
+                if (is_comment_symbol(language, id))
+                {
+                    roles[id] = role::comment;
+                }
+                else if (is_literal_symbol(language, id))
+                {
+                    roles[id] = role::literal;
+                }
+            }
+        }
+
+        // Appends the stripped text of `tree`, parsed from `source`, to `out`.
+        auto strip(const tree &tree, std::string_view source, std::string &out) const -> void
+        {
+            size_t first = out.size();
+            uint32_t last_end = 0;
+            bool pending_space = false;
+            bool pending_line = false;
+            std::string_view indentation;
+
+            auto flush = [&]()
+            {
+                if (out.size() > first)
+                {
+                    if (options.keep_lines && pending_line)
+                    {
+                        out.push_back('\n');
+                        out.append(indentation);
+                    }
+                    else if (pending_space)
+                    {
+                        out.push_back(' ');
+                    }
+                }
+                pending_space = false;
+                pending_line = false;
+            };
+            // Consumes the text between the previous token and `until`.
+            auto absorb = [&](uint32_t until)
+            {
+                if (until <= last_end)
+                {
+                    return;
+                }
+                std::string_view gap = source.substr(last_end, until - last_end);
+                last_end = until;
+                if (gap.find_first_not_of(" \t\n\r\f\v") != std::string_view::npos)
+                {
+                    flush();
+                    out.append(gap);
+                    return;
+                }
+                pending_space = true;
+                size_t newline = gap.find_last_of('\n');
+                if (newline != std::string_view::npos)
+                {
+                    pending_line = true;
+                    indentation = gap.substr(newline + 1);
+                }
+            };
+
+            visit(tree.get_root_node(),
+                  [&](node node) -> bool
+                  {
+                      symbol id = node.get_symbol();
+                      role kind = id < roles.size() ? roles[id] : role::other;
+                      if (kind == role::other && node.get_num_children() > 0)
+                      {
+                          return true;
+                      }
+
+                      extent<uint32_t> bytes = node.get_byte_range();
+                      absorb(bytes.start);
+                      if (kind == role::comment)
+                      {
+                          // A comment separates the tokens around it.
+                          pending_space = true;
+                      }
+                      else
+                      {
+                          flush();
+                          out.append(source.substr(bytes.start, bytes.end - bytes.start));
+                      }
+                      last_end = std::max(last_end, bytes.end);
+                      return false;
+                  });
+
+            // Trailing whitespace is dropped, but not trailing hidden text.
+            std::string_view rest = source.substr(std::min<size_t>(last_end, source.size()));
+            if (rest.find_first_not_of(" \t\n\r\f\v") != std::string_view::npos)
+            {
+                absorb(static_cast<uint32_t>(source.size()));
+            }
+        }
+
+        [[nodiscard]] auto strip(const tree &tree, std::string_view source) const -> std::string
+        {
+            std::string out;
+            out.reserve(source.size());
+            strip(tree, source, out);
+            return out;
+        }
+
+    private:
+        enum class role : uint8_t
+        {
+            other,
+            comment,
+            literal,
+        };
+
+        std::vector<role> roles;
+        strip_options options;
+    };
+
+    // Parses and strips every file in parallel; the result for files[i] is
+    // element i.
+    [[nodiscard]] inline auto strip_sources(std::span<const source_file> files,
+                                            strip_options options = {},
+                                            unsigned threads = 0) -> std::vector<std::string>
+    {
+        std::array<std::unique_ptr<source_stripper>, std::size(bundled_languages)> strippers;
+        for (const source_file &file : files)
+        {
+            auto &slot = strippers[static_cast<size_t>(file.language)];
+            if (!slot)
+            {
+                slot = std::make_unique<source_stripper>(get_language(file.language), options);
+            }
+        }
+
+        std::vector<std::string> results(files.size());
+        unsigned num_workers = get_worker_count(files.size(), threads);
+        parser_pool parsers{num_workers};
+        parallel_for(
+            files.size(),
+            [&](size_t index, unsigned worker)
+            {
+                const source_file &file = files[index];
+                tree tree = parsers.get(worker, get_language(file.language)).parse_string(file.text);
+                results[index].reserve(file.text.size());
+                strippers[static_cast<size_t>(file.language)]->strip(tree, file.text, results[index]);
+            },
+            num_workers);
+        return results;
+    }
+
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef CPP_TREE_SITTER_SUBTREE_SUMMARY_H
+#define CPP_TREE_SITTER_SUBTREE_SUMMARY_H
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/flat_tree.hpp"
+
+// A 64-bit Bloom summary of the symbols under every node of a flat_tree,
+// computed bottom-up in one reverse pass. A search for rare node types skips
+// any subtree whose summary has none of the target bits, which on large files
+// removes most of the tree from the walk.
+
+namespace ts
+{
+
+    class subtree_summary
+    {
+    public:
+        subtree_summary() = default;
+
+        explicit subtree_summary(const flat_tree &tree)
+        {
+            assign(tree);
+        }
+
+        auto assign(const flat_tree &tree) -> void
+        {
+            node_position size = tree.size();
+            masks.resize(size);
+            for (node_position position = 0; position < size; ++position)
+            {
+                masks[position] = get_mask(tree.get_symbol(position));
+            }
+            // Children follow their parents in preorder, so a reverse pass
+            // sees every subtree complete before folding it upwards.
+            for (node_position position = size; position-- > 1;)
+            {
+                masks[tree.get_parent(position)] |= masks[position];
+            }
+        }
+
+        [[nodiscard]] static auto get_mask(symbol symbol) -> uint64_t
+        {
+            return uint64_t{1} << ((symbol * 0x9E3779B97F4A7C15ull) >> 58);
+        }
+
+        [[nodiscard]] static auto get_mask(std::span<const symbol> symbols) -> uint64_t
+        {
+            uint64_t mask = 0;
+            for (symbol symbol : symbols)
+            {
+                mask |= get_mask(symbol);
+            }
+            return mask;
+        }
+
+        // False only if no node in the subtree of `position` has a symbol
+        // from `mask`.
+        [[nodiscard]] auto may_contain(node_position position, uint64_t mask) const -> bool
+        {
+            return (masks[position] & mask) != 0;
+        }
+
+        // Calls fn(position) in document order for each node of one of
+        // `symbols` in the subtree of `root`, skipping subtrees that cannot
+        // contain any. `tree` must be the tree the summary was built from.
+        template <typename Fn>
+        auto find(const flat_tree &tree, node_position root, std::span<const symbol> symbols, Fn &&fn) const -> void
+        {
+            uint64_t mask = get_mask(symbols);
+            node_position end = tree.get_subtree_end(root);
+            for (node_position position = root; position < end;)
+            {
+                if (!may_contain(position, mask))
+                {
+                    position = tree.get_subtree_end(position);
+                    continue;
+                }
+                if (std::find(symbols.begin(), symbols.end(), tree.get_symbol(position)) != symbols.end())
+                {
+                    fn(position);
+                }
+                ++position;
+            }
+        }
+
+    private:
+        std::vector<uint64_t> masks;
+    };
+
+}
+
+#endif
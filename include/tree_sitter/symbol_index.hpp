@@ -0,0 +1,92 @@
+#ifndef CPP_TREE_SITTER_SYMBOL_INDEX_H
+#define CPP_TREE_SITTER_SYMBOL_INDEX_H
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/flat_tree.hpp"
+
+// Posting lists of a flat_tree: for every symbol, the preorder positions of
+// its nodes in document order, stored back to back in one array. Built with a
+// counting sort over the symbol column, so enumerating all nodes of a type is
+// an array scan.
+
+namespace ts
+{
+
+    class symbol_index
+    {
+    public:
+        symbol_index() = default;
+
+        explicit symbol_index(const flat_tree &tree)
+        {
+            assign(tree);
+        }
+
+        auto assign(const flat_tree &tree) -> void
+        {
+            offsets.clear();
+            positions.clear();
+            node_position size = tree.size();
+            symbol max_symbol = 0;
+            for (node_position position = 0; position < size; ++position)
+            {
+                max_symbol = std::max(max_symbol, tree.get_symbol(position));
+            }
+
+            offsets.assign(static_cast<size_t>(max_symbol) + 2, 0);
+            for (node_position position = 0; position < size; ++position)
+            {
+                ++offsets[tree.get_symbol(position) + 1];
+            }
+            for (size_t i = 1; i < offsets.size(); ++i)
+            {
+                offsets[i] += offsets[i - 1];
+            }
+
+            positions.resize(size);
+            std::vector<node_position> next(offsets.begin(), offsets.end() - 1);
+            for (node_position position = 0; position < size; ++position)
+            {
+                positions[next[tree.get_symbol(position)]++] = position;
+            }
+        }
+
+        // All nodes of `symbol`, in document order.
+        [[nodiscard]] auto get_positions(symbol symbol) const -> std::span<const node_position>
+        {
+            if (static_cast<size_t>(symbol) + 1 >= offsets.size())
+            {
+                return {};
+            }
+            return {positions.data() + offsets[symbol], positions.data() + offsets[symbol + 1]};
+        }
+
+        // Nodes of `symbol` at positions in [begin, end); the subtree of `p`
+        // is [p, tree.get_subtree_end(p)).
+        [[nodiscard]] auto get_positions(symbol symbol, node_position begin, node_position end) const
+            -> std::span<const node_position>
+        {
+            std::span<const node_position> all = get_positions(symbol);
+            auto first = std::lower_bound(all.begin(), all.end(), begin);
+            auto last = std::lower_bound(first, all.end(), end);
+            return {first, last};
+        }
+
+        [[nodiscard]] auto count(symbol symbol) const -> node_position
+        {
+            return static_cast<node_position>(get_positions(symbol).size());
+        }
+
+    private:
+        // Positions of symbol s are positions[offsets[s] .. offsets[s + 1]).
+        std::vector<node_position> offsets;
+        std::vector<node_position> positions;
+    };
+
+}
+
+#endif
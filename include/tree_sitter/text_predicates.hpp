@@ -0,0 +1,285 @@
+#ifndef CPP_TREE_SITTER_TEXT_PREDICATES_H
+#define CPP_TREE_SITTER_TEXT_PREDICATES_H
+
+#include <memory>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tree_sitter/cpp-tree-sitter.hpp"
+
+// The text predicates the C library leaves to clients: #eq?, #match? and
+// #any-of?, each with a #not- form. They live apart from the core wrappers so
+// that only code evaluating them includes <regex>.
+//
+// Query files are written for Rust's regex crate. #match? patterns run on
+// std::regex (ECMAScript) after translating what has a direct equivalent:
+// leading inline flags of `i`, `\A` and `\z`, and `(?P<name>` groups. A
+// pattern that does not translate or compile is skipped, leaving its pattern
+// to match more than it should, and reported by get_unsupported().
+
+namespace ts
+{
+
+    struct unsupported_predicate
+    {
+        uint32_t pattern_index;
+        std::string message;
+    };
+
+    namespace detail
+    {
+        // Rewrites a Rust regex into ECMAScript syntax, or returns nullopt if
+        // it uses something with no equivalent.
+        [[nodiscard]] inline auto translate_rust_regex(std::string_view pattern,
+                                                       std::regex::flag_type &flags) -> std::optional<std::string>
+        {
+            if (pattern.starts_with("(?"))
+            {
+                size_t close = pattern.find(')');
+                std::string_view inline_flags = pattern.substr(2, close == std::string_view::npos ? 0 : close - 2);
+                if (!inline_flags.empty() && inline_flags.find_first_not_of('i') == std::string_view::npos)
+                {
+                    flags |= std::regex::icase;
+                    pattern.remove_prefix(close + 1);
+                }
+            }
+
+            std::string translated;
+            translated.reserve(pattern.size());
+            for (size_t i = 0; i < pattern.size(); ++i)
+            {
+                char c = pattern[i];
+                if (c == '\\' && i + 1 < pattern.size())
+                {
+                    char escaped = pattern[++i];
+                    if (escaped == 'A')
+                    {
+                        translated += '^';
+                    }
+                    else if (escaped == 'z')
+                    {
+                        translated += '$';
+                    }
+                    else if (escaped == 'p' || escaped == 'P' || (escaped == 'x' && pattern.substr(i + 1, 1) == "{"))
+                    {
+                        return std::nullopt;
+                    }
+                    else
+                    {
+                        translated += c;
+                        translated += escaped;
+                    }
+                }
+                else if (pattern.substr(i).starts_with("(?P<"))
+                {
+                    // Named groups capture like plain ones; names are unused.
+                    size_t close = pattern.find('>', i);
+                    if (close == std::string_view::npos)
+                    {
+                        return std::nullopt;
+                    }
+                    translated += '(';
+                    i = close;
+                }
+                else
+                {
+                    translated += c;
+                }
+            }
+            return translated;
+        }
+    }
+
+    class text_predicates
+    {
+    public:
+        text_predicates() = default;
+
+        explicit text_predicates(const query &query)
+        {
+            uint32_t num_patterns = query.get_num_patterns();
+            for (uint32_t pattern_index = 0; pattern_index < num_patterns; ++pattern_index)
+            {
+                uint32_t num_steps = 0;
+                TSQueryPredicateStep const *steps =
+                    ts_query_predicates_for_pattern(query.impl.get(), pattern_index, &num_steps);
+
+                // Each predicate is a run of steps terminated by a Done step:
+                // the name string first, followed by its arguments.
+                uint32_t begin = 0;
+                for (uint32_t end = 0; end < num_steps; ++end)
+                {
+                    if (steps[end].type != TSQueryPredicateStepTypeDone)
+                    {
+                        continue;
+                    }
+                    add(query, pattern_index, steps + begin, end - begin);
+                    begin = end + 1;
+                }
+            }
+        }
+
+        // Evaluates the predicates of the match's pattern against `source`;
+        // predicates other than the ones above are treated as satisfied.
+        [[nodiscard]] auto satisfies(const query_match &match, std::string_view source) const -> bool
+        {
+            if (match.get_pattern_index() >= predicates.size())
+            {
+                return true;
+            }
+            for (const predicate &predicate : predicates[match.get_pattern_index()])
+            {
+                node subject = match.find_capture(predicate.capture_id);
+                if (subject.is_null())
+                {
+                    continue;
+                }
+                std::string_view text = subject.get_source_range(source);
+                bool satisfied = false;
+                switch (predicate.operation)
+                {
+                case kind::eq:
+                    if (predicate.other_capture_id)
+                    {
+                        node other = match.find_capture(*predicate.other_capture_id);
+                        satisfied = !other.is_null() && text == other.get_source_range(source);
+                    }
+                    else
+                    {
+                        satisfied = text == predicate.values.front();
+                    }
+                    break;
+                case kind::match:
+                    satisfied = std::regex_search(text.begin(), text.end(), *predicate.pattern);
+                    break;
+                case kind::any_of:
+                    for (const std::string &value : predicate.values)
+                    {
+                        satisfied = satisfied || text == value;
+                    }
+                    break;
+                }
+                if (satisfied == predicate.negated)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // #match? predicates that were skipped, in pattern order.
+        [[nodiscard]] auto get_unsupported() const -> const std::vector<unsupported_predicate> &
+        {
+            return unsupported;
+        }
+
+    private:
+        enum class kind
+        {
+            eq,
+            match,
+            any_of,
+        };
+
+        struct predicate
+        {
+            kind operation;
+            bool negated;
+            uint32_t capture_id;
+            std::optional<uint32_t> other_capture_id;
+            std::vector<std::string> values;
+            std::shared_ptr<const std::regex> pattern;
+        };
+
+        auto add(const query &query, uint32_t pattern_index, TSQueryPredicateStep const *steps, uint32_t num_steps)
+            -> void
+        {
+            if (num_steps < 3 || steps[0].type != TSQueryPredicateStepTypeString ||
+                steps[1].type != TSQueryPredicateStepTypeCapture)
+            {
+                return;
+            }
+
+            std::string_view name = query.get_string_value(steps[0].value_id);
+            predicate predicate{};
+            predicate.negated = name.starts_with("not-");
+            if (predicate.negated)
+            {
+                name.remove_prefix(4);
+            }
+            predicate.capture_id = steps[1].value_id;
+
+            if (name == "eq?" && num_steps == 3)
+            {
+                predicate.operation = kind::eq;
+                if (steps[2].type == TSQueryPredicateStepTypeCapture)
+                {
+                    predicate.other_capture_id = steps[2].value_id;
+                }
+                else
+                {
+                    predicate.values.emplace_back(query.get_string_value(steps[2].value_id));
+                }
+            }
+            else if (name == "match?" && num_steps == 3 && steps[2].type == TSQueryPredicateStepTypeString)
+            {
+                predicate.operation = kind::match;
+                std::string_view pattern = query.get_string_value(steps[2].value_id);
+                predicate.pattern = compile(pattern);
+                if (!predicate.pattern)
+                {
+                    unsupported.push_back({pattern_index, "unsupported regex in #match? predicate: " + std::string{pattern}});
+                    return;
+                }
+            }
+            else if (name == "any-of?")
+            {
+                predicate.operation = kind::any_of;
+                for (uint32_t i = 2; i < num_steps; ++i)
+                {
+                    if (steps[i].type == TSQueryPredicateStepTypeString)
+                    {
+                        predicate.values.emplace_back(query.get_string_value(steps[i].value_id));
+                    }
+                }
+            }
+            else
+            {
+                return;
+            }
+
+            if (predicates.size() <= pattern_index)
+            {
+                predicates.resize(pattern_index + 1);
+            }
+            predicates[pattern_index].push_back(std::move(predicate));
+        }
+
+        [[nodiscard]] static auto compile(std::string_view pattern) -> std::shared_ptr<const std::regex>
+        {
+            std::regex::flag_type flags = std::regex::ECMAScript | std::regex::optimize;
+            std::optional<std::string> translated = detail::translate_rust_regex(pattern, flags);
+            if (!translated)
+            {
+                return nullptr;
+            }
+            try
+            {
+                return std::make_shared<const std::regex>(*translated, flags);
+            }
+            catch (const std::regex_error &)
+            {
+                return nullptr;
+            }
+        }
+
+        std::vector<std::vector<predicate>> predicates;
+        std::vector<unsupported_predicate> unsupported;
+    };
+
+}
+
+#endif
@@ -0,0 +1,78 @@
+// Checks for ts::node_path::seek, in particular that a target outside the
+// path leaves it at the deepest shared ancestor instead of above it.
+
+#include <cstdio>
+#include <string_view>
+
+#include "tree_sitter/cpp-tree-sitter.hpp"
+
+namespace
+{
+
+    int failures = 0;
+
+    auto check(bool condition, const char *what) -> void
+    {
+        if (!condition)
+        {
+            std::fprintf(stderr, "failed: %s\n", what);
+            ++failures;
+        }
+    }
+
+    // The first descendant of `root` with the given type and text.
+    auto find(ts::node root, std::string_view source, std::string_view type, std::string_view text) -> ts::node
+    {
+        ts::extent<uint32_t> bytes = root.get_byte_range();
+        if (root.get_type() == type && source.substr(bytes.start, bytes.end - bytes.start) == text)
+        {
+            return root;
+        }
+        for (uint32_t i = 0; i < root.get_num_children(); ++i)
+        {
+            ts::node found = find(root.get_child(i), source, type, text);
+            if (!found.is_null())
+            {
+                return found;
+            }
+        }
+        return ts::node{TSNode{}};
+    }
+
+}
+
+int main()
+{
+    constexpr std::string_view source = "void f() { int a; int b; }";
+    ts::parser parser{tree_sitter_c()};
+    ts::tree tree = parser.parse_string(source);
+    ts::tree other = parser.parse_string(source);
+    ts::node root = tree.get_root_node();
+    ts::node body = find(root, source, "compound_statement", "{ int a; int b; }");
+    check(!body.is_null(), "body found");
+
+    ts::node_path path{body};
+    ts::node a = find(root, source, "identifier", "a");
+    check(path.seek(a), "seek to a node below the path");
+    check(path.get_node().get_id() == a.get_id(), "path ends at the target");
+    check(path.get_depth() == 2, "path records the declaration and its identifier");
+
+    // Before the body, so every child of the body starts after it.
+    check(!path.seek(find(root, source, "identifier", "f")), "seek to a node before the path root");
+    check(path.get_depth() == 0, "failed seek keeps the path root");
+    check(path.get_node().get_id() == body.get_id(), "failed seek stops at the path root");
+
+    check(path.seek(a), "seek again after a failure");
+    ts::node b = find(root, source, "identifier", "b");
+    check(path.seek(b), "seek forward to a sibling subtree");
+    check(path.get_parent().get_type() == "declaration", "parent of b is its declaration");
+
+    // Inside the body's range but from another tree, so the seek walks down
+    // and back up again without finding it.
+    check(path.seek(a), "seek back to a");
+    check(!path.seek(find(other.get_root_node(), source, "identifier", "b")), "seek to a node of another tree");
+    check(path.get_depth() == 0, "walk back up stops at the shared ancestor");
+    check(path.get_node().get_id() == body.get_id(), "walk back up keeps the path root");
+
+    return failures == 0 ? 0 : 1;
+}
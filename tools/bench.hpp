@@ -0,0 +1,166 @@
+#ifndef CPP_TREE_SITTER_TOOLS_BENCH_H
+#define CPP_TREE_SITTER_TOOLS_BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tree_sitter/bundled.hpp"
+
+// Shared pieces of the benchmark tools: wall-clock sampling with
+// percentiles, and generated inputs for when no files are given.
+
+namespace bench
+{
+
+    using clock = std::chrono::steady_clock;
+
+    // Durations of repeated runs of one operation.
+    class samples
+    {
+    public:
+        auto add(clock::duration duration) -> void
+        {
+            durations.push_back(duration);
+            sorted = false;
+        }
+
+        template <typename Fn>
+        auto time(Fn &&fn) -> void
+        {
+            clock::time_point start = clock::now();
+            fn();
+            add(clock::now() - start);
+        }
+
+        auto merge(const samples &other) -> void
+        {
+            durations.insert(durations.end(), other.durations.begin(), other.durations.end());
+            sorted = false;
+        }
+
+        // The `percent`th percentile in microseconds, by nearest rank.
+        [[nodiscard]] auto get_percentile(double percent) -> double
+        {
+            if (durations.empty())
+            {
+                return 0;
+            }
+            if (!sorted)
+            {
+                std::sort(durations.begin(), durations.end());
+                sorted = true;
+            }
+            auto rank = static_cast<size_t>(percent / 100 * static_cast<double>(durations.size() - 1) + 0.5);
+            return std::chrono::duration<double, std::micro>(durations[rank]).count();
+        }
+
+        // Prints one row of min, p50, p90, p99 and max.
+        auto print(std::string_view label) -> void
+        {
+            std::printf("%-32.*s %8zu %12.1f %12.1f %12.1f %12.1f %12.1f\n",
+                        static_cast<int>(label.size()),
+                        label.data(),
+                        durations.size(),
+                        get_percentile(0),
+                        get_percentile(50),
+                        get_percentile(90),
+                        get_percentile(99),
+                        get_percentile(100));
+        }
+
+        static auto print_header() -> void
+        {
+            std::printf("%-32s %8s %12s %12s %12s %12s %12s\n", "us", "runs", "min", "p50", "p90", "p99", "max");
+        }
+
+    private:
+        std::vector<clock::duration> durations;
+        bool sorted = true;
+    };
+
+    // About `bytes` of C++: classes with loops, branches and switches, plus
+    // the occasional lambda, throw and goto.
+    inline auto generate_cpp(size_t bytes) -> std::string
+    {
+        std::string source = "#include <stdexcept>\n\n";
+        for (size_t i = 0; source.size() < bytes; ++i)
+        {
+            std::string n = std::to_string(i);
+            source += "namespace module_" + n + "\n{\n";
+            source += "    struct widget_" + n + "\n    {\n";
+            source += "        int value = " + n + ";\n\n";
+            source += "        auto compute(int x) const -> int\n        {\n";
+            source += "            int total = 0;\n";
+            source += "            for (int k = 0; k < x; ++k)\n            {\n";
+            source += "                if (k % 3 == 0)\n                {\n";
+            source += "                    total += value * k;\n                }\n";
+            source += "                else\n                {\n                    total -= k;\n                }\n";
+            source += "            }\n";
+            source += "            switch (x)\n            {\n";
+            source += "            case 0:\n                return 1;\n            default:\n                break;\n";
+            source += "            }\n";
+            if (i % 20 == 0)
+            {
+                source += "            auto scale = [this](int y) { return y * value; };\n";
+                source += "            total = scale(total);\n";
+            }
+            source += "            return total;\n        }\n    };\n";
+            if (i % 50 == 0)
+            {
+                source += "\n    void check_" + n + "(int x)\n    {\n";
+                source += "        if (x < 0)\n        {\n";
+                source += "            throw std::runtime_error{\"negative\"};\n        }\n    }\n";
+            }
+            if (i % 200 == 0)
+            {
+                source += "\n    int retry_" + n + "(int x)\n    {\n    again:\n";
+                source += "        if (--x > 0)\n        {\n            goto again;\n        }\n";
+                source += "        return x;\n    }\n";
+            }
+            source += "}\n\n";
+        }
+        return source;
+    }
+
+    // About `bytes` of Python in the same shape as generate_cpp.
+    inline auto generate_python(size_t bytes) -> std::string
+    {
+        std::string source = "import math\n\n";
+        for (size_t i = 0; source.size() < bytes; ++i)
+        {
+            std::string n = std::to_string(i);
+            source += "class Widget" + n + ":\n";
+            source += "    \"\"\"A generated class.\"\"\"\n\n";
+            source += "    def __init__(self):\n        self.value = " + n + "\n\n";
+            source += "    def compute(self, x):\n";
+            source += "        total = 0\n";
+            source += "        for k in range(x):\n";
+            source += "            if k % 3 == 0:\n                total += self.value * k\n";
+            source += "            else:\n                total -= k\n";
+            source += "        return math.floor(total)\n\n\n";
+        }
+        return source;
+    }
+
+    // A generated input for `language`, or an empty string if there is no
+    // generator for it.
+    inline auto generate(ts::bundled_language language, size_t bytes) -> std::string
+    {
+        switch (language)
+        {
+        case ts::bundled_language::cpp:
+            return generate_cpp(bytes);
+        case ts::bundled_language::python:
+            return generate_python(bytes);
+        default:
+            return {};
+        }
+    }
+
+}
+
+#endif
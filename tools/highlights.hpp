@@ -0,0 +1,56 @@
+#ifndef CPP_TREE_SITTER_TOOLS_HIGHLIGHTS_H
+#define CPP_TREE_SITTER_TOOLS_HIGHLIGHTS_H
+
+#include <array>
+#include <filesystem>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#include "read_file.hpp"
+#include "tree_sitter/bundled.hpp"
+
+// Loading the highlights queries shipped with the grammar checkouts, for the
+// tools that serve semantic tokens.
+
+namespace tools
+{
+
+    using highlight_queries = std::array<std::string, std::size(ts::bundled_languages)>;
+
+    // Inherited queries (C for C++, JavaScript for TypeScript) come first.
+    inline auto load_highlights(const std::filesystem::path &directory) -> highlight_queries
+    {
+        highlight_queries queries;
+        for (ts::bundled_language language : ts::bundled_languages)
+        {
+            // A grammar without the query just gets no semantic tokens.
+            auto read = [&](std::string_view grammar)
+            { return read_file(directory / grammar / "queries" / "highlights.scm").value_or(""); };
+            std::string &query = queries[static_cast<size_t>(language)];
+            switch (language)
+            {
+            case ts::bundled_language::cpp:
+                query = read("tree-sitter-c") + "\n" + read("tree-sitter-cpp");
+                break;
+            case ts::bundled_language::c_sharp:
+                query = read("tree-sitter-c-sharp");
+                break;
+            case ts::bundled_language::typescript:
+            case ts::bundled_language::tsx:
+                query = read("tree-sitter-javascript") + "\n" + read("tree-sitter-typescript");
+                break;
+            default:
+                query = read("tree-sitter-" + std::string{ts::get_name(language)});
+            }
+            if (query.find_first_not_of(" \t\r\n") == std::string::npos)
+            {
+                query.clear();
+            }
+        }
+        return queries;
+    }
+
+}
+
+#endif
@@ -0,0 +1,224 @@
+// A language server for the bundled grammars, speaking LSP over stdio or, with
+// --socket, over a unix socket with one session per connection.
+//
+//   ts-language-server [--queries DIR] [--socket PATH]
+//
+// Semantic tokens use the highlights.scm files of the grammar checkouts under
+// DIR, which defaults to the build directory the grammars were cloned into.
+// Languages without a readable highlights query are served without tokens.
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "highlights.hpp"
+#include "tree_sitter/language_server.hpp"
+
+#ifndef TREE_SITTER_QUERIES_DIR
+#define TREE_SITTER_QUERIES_DIR "."
+#endif
+
+namespace
+{
+
+    using tools::highlight_queries;
+
+    // Reads Content-Length framed messages from a file descriptor.
+    class message_reader
+    {
+    public:
+        explicit message_reader(int fd)
+            : fd{fd}
+        {
+        }
+
+        auto read(std::string &message) -> bool
+        {
+            size_t header_end;
+            while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos)
+            {
+                if (!fill())
+                {
+                    return false;
+                }
+            }
+
+            size_t length = 0;
+            std::string_view headers{buffer.data(), header_end};
+            for (size_t start = 0; start < headers.size();)
+            {
+                size_t end = std::min(headers.find("\r\n", start), headers.size());
+                std::string_view line = headers.substr(start, end - start);
+                constexpr std::string_view name = "content-length:";
+                if (line.size() > name.size() &&
+                    std::equal(name.begin(),
+                               name.end(),
+                               line.begin(),
+                               [](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); }))
+                {
+                    std::string_view value = line.substr(name.size());
+                    value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+                    std::from_chars(value.data(), value.data() + value.size(), length);
+                }
+                start = end + 2;
+            }
+
+            size_t body = header_end + 4;
+            while (buffer.size() < body + length)
+            {
+                if (!fill())
+                {
+                    return false;
+                }
+            }
+            message.assign(buffer, body, length);
+            buffer.erase(0, body + length);
+            return true;
+        }
+
+    private:
+        auto fill() -> bool
+        {
+            char chunk[1 << 16];
+            ssize_t count;
+            do
+            {
+                count = ::read(fd, chunk, sizeof(chunk));
+            } while (count < 0 && errno == EINTR);
+            if (count <= 0)
+            {
+                return false;
+            }
+            buffer.append(chunk, static_cast<size_t>(count));
+            return true;
+        }
+
+        int fd;
+        std::string buffer;
+    };
+
+    auto write_message(int fd, std::string_view message) -> bool
+    {
+        std::string frame = "Content-Length: " + std::to_string(message.size()) + "\r\n\r\n";
+        frame.append(message);
+        for (size_t written = 0; written < frame.size();)
+        {
+            ssize_t count = ::write(fd, frame.data() + written, frame.size() - written);
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                return false;
+            }
+            written += static_cast<size_t>(count);
+        }
+        return true;
+    }
+
+    // Runs one session until exit or end of input. Returns the exit code.
+    auto serve(int input, int output, const highlight_queries &highlights) -> int
+    {
+        ts::language_server server{highlights};
+        message_reader reader{input};
+        std::string message;
+        std::string response;
+        while (reader.read(message))
+        {
+            if (server.handle(message, response) && !write_message(output, response))
+            {
+                break;
+            }
+            if (server.is_exiting())
+            {
+                break;
+            }
+        }
+        return server.get_exit_code();
+    }
+
+    auto listen_on(const std::string &path, const highlight_queries &highlights) -> int
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            std::fprintf(stderr, "socket path too long: %s\n", path.c_str());
+            return 1;
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        ::unlink(path.c_str());
+        if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+            ::listen(listener, SOMAXCONN) < 0)
+        {
+            std::fprintf(stderr, "cannot listen on %s: %s\n", path.c_str(), std::strerror(errno));
+            return 1;
+        }
+        while (true)
+        {
+            int connection = ::accept(listener, nullptr, nullptr);
+            if (connection < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                std::fprintf(stderr, "accept failed: %s\n", std::strerror(errno));
+                return 1;
+            }
+            std::thread{[connection, &highlights]()
+                        {
+                            serve(connection, connection, highlights);
+                            ::close(connection);
+                        }}
+                .detach();
+        }
+    }
+
+}
+
+int main(int argc, char **argv)
+{
+    std::filesystem::path queries = TREE_SITTER_QUERIES_DIR;
+    std::string socket_path;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view argument = argv[i];
+        if (argument == "--queries" && i + 1 < argc)
+        {
+            queries = argv[++i];
+        }
+        else if (argument == "--socket" && i + 1 < argc)
+        {
+            socket_path = argv[++i];
+        }
+        else if (argument != "--stdio")
+        {
+            std::fprintf(stderr, "usage: %s [--queries DIR] [--socket PATH | --stdio]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    static const highlight_queries highlights = tools::load_highlights(queries);
+    if (!socket_path.empty())
+    {
+        return listen_on(socket_path, highlights);
+    }
+    return serve(STDIN_FILENO, STDOUT_FILENO, highlights);
+}
@@ -0,0 +1,366 @@
+// Per-keystroke latency of ts::language_server on large documents. Each
+// session opens the inputs, then types and erases a short identifier at
+// random line ends; after every keystroke it sends didChange and asks for a
+// semantic token delta and the document symbols, as an editor does. Several
+// sessions on their own threads load the machine the way several open
+// editors would.
+//
+//   ts-language-server-bench [--queries DIR] [--edits N] [--sessions N] [--size BYTES] [FILE...]
+//
+// Without files, generated C++ and Python documents of --size bytes (default
+// 1 MiB) are used.
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bench.hpp"
+#include "highlights.hpp"
+#include "read_file.hpp"
+#include "tree_sitter/bundled.hpp"
+#include "tree_sitter/language_server.hpp"
+
+#ifndef TREE_SITTER_QUERIES_DIR
+#define TREE_SITTER_QUERIES_DIR "."
+#endif
+
+namespace
+{
+
+    struct input
+    {
+        std::string uri;
+        ts::bundled_language language;
+        std::string text;
+    };
+
+    struct latencies
+    {
+        bench::samples open;
+        bench::samples change;
+        bench::samples delta;
+        bench::samples symbols;
+        bench::samples keystroke;
+        size_t errors = 0;
+    };
+
+    // Builds requests with the server's own JSON writer.
+    class client
+    {
+    public:
+        client(ts::language_server &server, latencies &timings)
+            : server{server},
+              timings{timings}
+        {
+        }
+
+        auto send(std::string &message) -> void
+        {
+            // Errors come right after the id, before any document text.
+            if (server.handle(message, response) &&
+                std::string_view{response}.substr(0, 64).find("\"error\"") != std::string_view::npos)
+            {
+                ++timings.errors;
+            }
+        }
+
+        auto request(std::string_view method, std::string_view params) -> std::string
+        {
+            std::string message;
+            ts::detail::json_writer writer{message};
+            writer.begin_object();
+            writer.key("jsonrpc");
+            writer.string("2.0");
+            writer.key("id");
+            writer.number(++next_id);
+            writer.key("method");
+            writer.string(method);
+            writer.key("params");
+            writer.raw(params);
+            writer.end_object();
+            return message;
+        }
+
+        auto notification(std::string_view method, std::string_view params) -> std::string
+        {
+            std::string message;
+            ts::detail::json_writer writer{message};
+            writer.begin_object();
+            writer.key("jsonrpc");
+            writer.string("2.0");
+            writer.key("method");
+            writer.string(method);
+            writer.key("params");
+            writer.raw(params);
+            writer.end_object();
+            return message;
+        }
+
+        [[nodiscard]] auto get_response() const -> std::string_view
+        {
+            return response;
+        }
+
+    private:
+        ts::language_server &server;
+        latencies &timings;
+        std::string response;
+        uint64_t next_id = 0;
+    };
+
+    auto text_document(std::string_view uri) -> std::string
+    {
+        std::string params;
+        ts::detail::json_writer writer{params};
+        writer.begin_object();
+        writer.key("textDocument");
+        writer.begin_object();
+        writer.key("uri");
+        writer.string(uri);
+        writer.end_object();
+        writer.end_object();
+        return params;
+    }
+
+    // The result id in a semantic tokens response.
+    auto get_result_id(std::string_view response) -> std::string
+    {
+        constexpr std::string_view key = "\"resultId\":\"";
+        size_t start = response.find(key);
+        if (start == std::string_view::npos)
+        {
+            return {};
+        }
+        start += key.size();
+        return std::string{response.substr(start, response.find('"', start) - start)};
+    }
+
+    auto run_session(const tools::highlight_queries &highlights,
+                     const std::vector<input> &inputs,
+                     unsigned edits,
+                     unsigned seed,
+                     latencies &timings) -> void
+    {
+        ts::language_server server{highlights};
+        client client{server, timings};
+        std::string message = client.request(
+            "initialize", R"({"capabilities":{"general":{"positionEncodings":["utf-8","utf-16"]}}})");
+        client.send(message);
+        message = client.notification("initialized", "{}");
+        client.send(message);
+
+        std::vector<std::string> result_ids;
+        std::vector<std::vector<uint32_t>> line_ends;
+        for (const input &document : inputs)
+        {
+            std::string params;
+            ts::detail::json_writer writer{params};
+            writer.begin_object();
+            writer.key("textDocument");
+            writer.begin_object();
+            writer.key("uri");
+            writer.string(document.uri);
+            writer.key("languageId");
+            writer.string(ts::get_name(document.language));
+            writer.key("version");
+            writer.number(1);
+            writer.key("text");
+            writer.string(document.text);
+            writer.end_object();
+            writer.end_object();
+            message = client.notification("textDocument/didOpen", params);
+            timings.open.time([&] { client.send(message); });
+
+            message = client.request("textDocument/semanticTokens/full", text_document(document.uri));
+            client.send(message);
+            result_ids.push_back(get_result_id(client.get_response()));
+
+            // Byte length of every line, which with UTF-8 positions is also
+            // the character of its end.
+            std::vector<uint32_t> &ends = line_ends.emplace_back();
+            size_t start = 0;
+            for (size_t newline = document.text.find('\n'); newline != std::string::npos;
+                 newline = document.text.find('\n', start))
+            {
+                ends.push_back(static_cast<uint32_t>(newline - start));
+                start = newline + 1;
+            }
+        }
+
+        // Type `word` one character at a time at the end of a random line,
+        // then erase it again, so documents keep their size.
+        constexpr std::string_view word = "value";
+        std::mt19937 random{seed};
+        for (unsigned edit = 0; edit < edits;)
+        {
+            size_t index = random() % inputs.size();
+            const input &document = inputs[index];
+            const std::vector<uint32_t> &ends = line_ends[index];
+            if (ends.empty())
+            {
+                break;
+            }
+            auto line = static_cast<uint32_t>(random() % ends.size());
+            uint32_t column = ends[line];
+            for (size_t step = 0; step < word.size() * 2 && edit < edits; ++step, ++edit)
+            {
+                bool typing = step < word.size();
+                size_t length = typing ? step : word.size() * 2 - step;
+                std::string params;
+                ts::detail::json_writer writer{params};
+                writer.begin_object();
+                writer.key("textDocument");
+                writer.begin_object();
+                writer.key("uri");
+                writer.string(document.uri);
+                writer.key("version");
+                writer.number(2 + edit);
+                writer.end_object();
+                writer.key("contentChanges");
+                writer.begin_array();
+                writer.begin_object();
+                writer.key("range");
+                writer.raw("{\"start\":{\"line\":" + std::to_string(line) + ",\"character\":" +
+                           std::to_string(column + (typing ? length : length - 1)) + "},\"end\":{\"line\":" +
+                           std::to_string(line) + ",\"character\":" + std::to_string(column + length) + "}}");
+                writer.key("text");
+                writer.string(typing ? word.substr(step, 1) : std::string_view{});
+                writer.end_object();
+                writer.end_array();
+                writer.end_object();
+
+                std::string change = client.notification("textDocument/didChange", params);
+                std::string delta_params = text_document(document.uri);
+                delta_params.pop_back();
+                delta_params += ",\"previousResultId\":\"" + result_ids[index] + "\"}";
+                std::string delta = client.request("textDocument/semanticTokens/full/delta", delta_params);
+                std::string symbols = client.request("textDocument/documentSymbol", text_document(document.uri));
+
+                bench::clock::time_point start = bench::clock::now();
+                timings.change.time([&] { client.send(change); });
+                timings.delta.time([&] { client.send(delta); });
+                result_ids[index] = get_result_id(client.get_response());
+                timings.symbols.time([&] { client.send(symbols); });
+                timings.keystroke.add(bench::clock::now() - start);
+            }
+        }
+    }
+
+}
+
+int main(int argc, char **argv)
+{
+    std::filesystem::path queries = TREE_SITTER_QUERIES_DIR;
+    unsigned edits = 500;
+    unsigned sessions = 1;
+    size_t size = size_t{1} << 20;
+    std::vector<std::string_view> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view argument = argv[i];
+        auto parse = [&](auto &value)
+        {
+            std::string_view text = argv[++i];
+            std::from_chars(text.data(), text.data() + text.size(), value);
+        };
+        if (argument == "--queries" && i + 1 < argc)
+        {
+            queries = argv[++i];
+        }
+        else if (argument == "--edits" && i + 1 < argc)
+        {
+            parse(edits);
+        }
+        else if (argument == "--sessions" && i + 1 < argc)
+        {
+            parse(sessions);
+        }
+        else if (argument == "--size" && i + 1 < argc)
+        {
+            parse(size);
+        }
+        else if (argument.starts_with("--"))
+        {
+            std::fprintf(stderr,
+                         "usage: %s [--queries DIR] [--edits N] [--sessions N] [--size BYTES] [FILE...]\n",
+                         argv[0]);
+            return 2;
+        }
+        else
+        {
+            files.push_back(argument);
+        }
+    }
+
+    std::vector<input> inputs;
+    for (std::string_view file : files)
+    {
+        std::optional<ts::bundled_language> language = ts::detect_language(file);
+        if (!language)
+        {
+            std::fprintf(stderr, "unknown language: %.*s\n", static_cast<int>(file.size()), file.data());
+            return 2;
+        }
+        std::optional<std::string> text = tools::read_file(file);
+        if (!text)
+        {
+            std::fprintf(stderr, "cannot read %.*s\n", static_cast<int>(file.size()), file.data());
+            return 1;
+        }
+        inputs.push_back({"file://" + std::filesystem::absolute(file).string(), *language, std::move(*text)});
+    }
+    if (inputs.empty())
+    {
+        inputs.push_back({"file:///generated.cpp", ts::bundled_language::cpp, bench::generate_cpp(size)});
+        inputs.push_back({"file:///generated.py", ts::bundled_language::python, bench::generate_python(size)});
+    }
+
+    const tools::highlight_queries highlights = tools::load_highlights(queries);
+    std::vector<latencies> per_session(std::max(1u, sessions));
+    {
+        std::vector<std::jthread> threads;
+        for (unsigned session = 0; session < per_session.size(); ++session)
+        {
+            threads.emplace_back(
+                [&, session] { run_session(highlights, inputs, edits, session + 1, per_session[session]); });
+        }
+    }
+
+    latencies total;
+    for (const latencies &session : per_session)
+    {
+        total.open.merge(session.open);
+        total.change.merge(session.change);
+        total.delta.merge(session.delta);
+        total.symbols.merge(session.symbols);
+        total.keystroke.merge(session.keystroke);
+        total.errors += session.errors;
+    }
+    for (const input &document : inputs)
+    {
+        bool tokens = !highlights[static_cast<size_t>(document.language)].empty();
+        std::printf("%s: %zu bytes%s\n",
+                    document.uri.c_str(),
+                    document.text.size(),
+                    tokens ? "" : " (no highlights query, semantic tokens are empty)");
+    }
+    std::printf("%zu sessions, %u edits each, %zu error responses\n",
+                per_session.size(),
+                edits,
+                total.errors);
+    bench::samples::print_header();
+    total.open.print("didOpen");
+    total.change.print("didChange");
+    total.delta.print("semanticTokens/full/delta");
+    total.symbols.print("documentSymbol");
+    total.keystroke.print("keystroke (all three)");
+    return total.errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,283 @@
+// A parse server for the bundled grammars on a unix socket. Clients send
+// request frames as described in tree_sitter/parse_server.hpp and get one
+// response frame per request, matched by id and possibly out of order.
+// Requests from all connections go to one pool of parse workers; each
+// connection has a writer thread that sends its responses, with parsed trees
+// in a sealed memfd passed alongside the frame when the request asks for it.
+//
+//   ts-parse-server --socket PATH [--threads N]
+
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "tree_sitter/parse_server.hpp"
+
+namespace
+{
+
+    // Larger frames are taken as a broken client.
+    constexpr uint32_t max_frame_size = 1u << 30;
+
+    auto read_exact(int fd, char *data, size_t size) -> bool
+    {
+        while (size > 0)
+        {
+            ssize_t count = ::read(fd, data, size);
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                return false;
+            }
+            data += count;
+            size -= static_cast<size_t>(count);
+        }
+        return true;
+    }
+
+    auto write_all(int fd, std::string_view data) -> bool
+    {
+        while (!data.empty())
+        {
+            ssize_t count = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                return false;
+            }
+            data.remove_prefix(static_cast<size_t>(count));
+        }
+        return true;
+    }
+
+    // Sends a frame, passing `memory_fd` (if not -1) along with its first
+    // bytes.
+    auto send_frame(int fd, std::string_view frame, int memory_fd) -> bool
+    {
+        if (memory_fd < 0)
+        {
+            return write_all(fd, frame);
+        }
+        iovec data{const_cast<char *>(frame.data()), frame.size()};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr message{};
+        message.msg_iov = &data;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        cmsghdr *header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(header), &memory_fd, sizeof(int));
+
+        ssize_t count;
+        do
+        {
+            count = ::sendmsg(fd, &message, MSG_NOSIGNAL);
+        } while (count < 0 && errno == EINTR);
+        return count > 0 && write_all(fd, frame.substr(static_cast<size_t>(count)));
+    }
+
+    // One client. Workers hand responses to post(), which only queues them;
+    // the connection's own writer thread does the blocking sends, so a client
+    // that stops reading holds up nobody but itself. Once too many responses
+    // are outstanding, reading its next request waits instead.
+    class connection
+    {
+    public:
+        explicit connection(int fd)
+            : fd{fd},
+              writer{[this] { write_responses(); }}
+        {
+        }
+
+        connection(const connection &) = delete;
+        auto operator=(const connection &) -> connection & = delete;
+
+        // Waits for every submitted request to be answered and sent.
+        ~connection()
+        {
+            {
+                std::lock_guard lock{outbox_lock};
+                closing = true;
+            }
+            outbox_ready.notify_all();
+            writer.join();
+            ::close(fd);
+        }
+
+        // Reserves room for one more response, waiting while the backlog is
+        // full.
+        auto expect() -> void
+        {
+            std::unique_lock lock{outbox_lock};
+            outbox_drained.wait(lock, [&] { return in_flight + outbox.size() < max_backlog; });
+            ++in_flight;
+        }
+
+        // Notifies under the lock: once in_flight reaches zero the writer may
+        // return and the connection be destroyed as soon as it is released.
+        auto post(ts::parse_response &&response) -> void
+        {
+            std::lock_guard lock{outbox_lock};
+            outbox.push_back(std::move(response));
+            --in_flight;
+            outbox_ready.notify_one();
+        }
+
+    private:
+        static constexpr size_t max_backlog = 1024;
+
+        auto write_responses() -> void
+        {
+            std::deque<ts::parse_response> sending;
+            std::string frame;
+            bool broken = false;
+            while (true)
+            {
+                {
+                    std::unique_lock lock{outbox_lock};
+                    outbox_ready.wait(lock, [&] { return !outbox.empty() || (closing && in_flight == 0); });
+                    if (outbox.empty())
+                    {
+                        return;
+                    }
+                    sending.swap(outbox);
+                }
+                outbox_drained.notify_all();
+                for (ts::parse_response &response : sending)
+                {
+                    frame.clear();
+                    ts::encode_response(response, frame);
+                    broken = broken || !send_frame(fd, frame, response.memory_fd);
+                    if (response.memory_fd >= 0)
+                    {
+                        ::close(response.memory_fd);
+                    }
+                }
+                sending.clear();
+            }
+        }
+
+        int fd;
+        std::mutex outbox_lock;
+        std::condition_variable outbox_ready;
+        std::condition_variable outbox_drained;
+        std::deque<ts::parse_response> outbox;
+        size_t in_flight = 0;
+        bool closing = false;
+        // Last, so that it starts once everything above exists.
+        std::thread writer;
+    };
+
+    auto serve(int fd, ts::parse_server &server) -> void
+    {
+        connection client{fd};
+        std::string body;
+        while (true)
+        {
+            uint32_t size = 0;
+            if (!read_exact(fd, reinterpret_cast<char *>(&size), sizeof(size)) || size > max_frame_size)
+            {
+                return;
+            }
+            body.resize(size);
+            if (!read_exact(fd, body.data(), size))
+            {
+                return;
+            }
+
+            client.expect();
+            ts::parse_request request;
+            if (!ts::decode_request(body, request))
+            {
+                ts::parse_response response;
+                response.id = size >= 4 ? ts::detail::get<uint32_t>(body, 0) : 0;
+                response.status = ts::parse_status::error;
+                response.payload = "malformed request";
+                client.post(std::move(response));
+                continue;
+            }
+            server.submit(std::move(request),
+                          [&client](ts::parse_response &&response) { client.post(std::move(response)); });
+        }
+    }
+
+}
+
+int main(int argc, char **argv)
+{
+    std::string path;
+    unsigned threads = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view argument = argv[i];
+        if (argument == "--socket" && i + 1 < argc)
+        {
+            path = argv[++i];
+        }
+        else if (argument == "--threads" && i + 1 < argc)
+        {
+            std::string_view value = argv[++i];
+            std::from_chars(value.data(), value.data() + value.size(), threads);
+        }
+        else
+        {
+            path.clear();
+            break;
+        }
+    }
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+    {
+        std::fprintf(stderr, "usage: %s --socket PATH [--threads N]\n", argv[0]);
+        return 2;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(path.c_str());
+    if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+        ::listen(listener, SOMAXCONN) < 0)
+    {
+        std::fprintf(stderr, "cannot listen on %s: %s\n", path.c_str(), std::strerror(errno));
+        return 1;
+    }
+
+    ts::parse_server server{threads};
+    while (true)
+    {
+        int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::fprintf(stderr, "accept failed: %s\n", std::strerror(errno));
+            return 1;
+        }
+        std::thread{serve, fd, std::ref(server)}.detach();
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef CPP_TREE_SITTER_TOOLS_READ_FILE_H
+#define CPP_TREE_SITTER_TOOLS_READ_FILE_H
+
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+
+namespace tools
+{
+
+    // The contents of `path`, or nullopt if it cannot be opened or read.
+    inline auto read_file(const std::filesystem::path &path) -> std::optional<std::string>
+    {
+        std::ifstream file{path, std::ios::binary};
+        if (!file)
+        {
+            return std::nullopt;
+        }
+        std::ostringstream text;
+        // An empty file sets failbit on `text` without being an error.
+        if (file.peek() != std::ifstream::traits_type::eof() && !(text << file.rdbuf()))
+        {
+            return std::nullopt;
+        }
+        if (file.bad())
+        {
+            return std::nullopt;
+        }
+        return text.str();
+    }
+
+}
+
+#endif
@@ -0,0 +1,180 @@
+// Times subtree_summary on large C++ inputs: building the summary, and
+// finding rare node types with it against full walks of the flat tree and of
+// the syntax tree itself.
+//
+//   ts-subtree-summary-bench [--repeat N] [--size BYTES] [--symbol NAME]... [FILE...]
+//
+// Files are parsed with the bundled C++ grammar; without any, a generated
+// translation unit of --size bytes (default 8 MiB) is used. The default
+// symbols are throw_statement, goto_statement and lambda_expression.
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench.hpp"
+#include "read_file.hpp"
+#include "tree_sitter/cpp-tree-sitter.hpp"
+#include "tree_sitter/flat_tree.hpp"
+#include "tree_sitter/subtree_summary.hpp"
+
+namespace
+{
+
+    auto run(std::string_view name, std::string_view source, const std::vector<ts::symbol> &symbols, unsigned repeat)
+        -> void
+    {
+        ts::parser parser{tree_sitter_cpp()};
+        bench::samples parse_samples;
+        ts::tree tree = parser.parse_string(source);
+        parse_samples.time([&] { tree = parser.parse_string(source); });
+
+        ts::flat_tree flat;
+        ts::subtree_summary summary;
+        bench::samples flatten_samples;
+        bench::samples summary_samples;
+        bench::samples cursor_walk_samples;
+        bench::samples flat_walk_samples;
+        bench::samples find_samples;
+        size_t expected = 0;
+        size_t found = 0;
+        size_t visited = 0;
+        for (unsigned run = 0; run < repeat; ++run)
+        {
+            flatten_samples.time([&] { flat.assign(tree.get_root_node()); });
+            summary_samples.time([&] { summary.assign(flat); });
+
+            size_t cursor_count = 0;
+            cursor_walk_samples.time(
+                [&]
+                {
+                    ts::visit(tree.get_root_node(),
+                              [&](ts::node node)
+                              {
+                                  cursor_count += std::find(symbols.begin(), symbols.end(), node.get_symbol()) !=
+                                                  symbols.end();
+                              });
+                });
+
+            expected = 0;
+            flat_walk_samples.time(
+                [&]
+                {
+                    for (ts::node_position position = 0; position < flat.size(); ++position)
+                    {
+                        expected += std::find(symbols.begin(), symbols.end(), flat.get_symbol(position)) !=
+                                    symbols.end();
+                    }
+                });
+
+            found = 0;
+            find_samples.time([&] { summary.find(flat, 0, symbols, [&](ts::node_position) { ++found; }); });
+            if (found != expected || cursor_count != expected)
+            {
+                std::fprintf(stderr, "%.*s: mismatched results\n", static_cast<int>(name.size()), name.data());
+            }
+        }
+
+        // Nodes the pruned search looks at, for the skip ratio.
+        uint64_t mask = ts::subtree_summary::get_mask(symbols);
+        for (ts::node_position position = 0; position < flat.size();)
+        {
+            ++visited;
+            position = summary.may_contain(position, mask) ? position + 1 : flat.get_subtree_end(position);
+        }
+
+        std::printf("%.*s: %zu bytes, %u nodes, %zu matches, %zu nodes visited by find (%.2f%%)\n",
+                    static_cast<int>(name.size()),
+                    name.data(),
+                    source.size(),
+                    flat.size(),
+                    expected,
+                    visited,
+                    flat.size() ? 100.0 * static_cast<double>(visited) / flat.size() : 0.0);
+        bench::samples::print_header();
+        parse_samples.print("parse (once)");
+        flatten_samples.print("flat_tree::assign");
+        summary_samples.print("subtree_summary::assign");
+        cursor_walk_samples.print("baseline: cursor walk");
+        flat_walk_samples.print("baseline: flat walk");
+        find_samples.print("subtree_summary::find");
+        std::printf("\n");
+    }
+
+}
+
+int main(int argc, char **argv)
+{
+    unsigned repeat = 20;
+    size_t size = size_t{8} << 20;
+    std::vector<std::string_view> names;
+    std::vector<std::string_view> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view argument = argv[i];
+        if ((argument == "--repeat" || argument == "--size") && i + 1 < argc)
+        {
+            std::string_view value = argv[++i];
+            if (argument == "--repeat")
+            {
+                std::from_chars(value.data(), value.data() + value.size(), repeat);
+            }
+            else
+            {
+                std::from_chars(value.data(), value.data() + value.size(), size);
+            }
+        }
+        else if (argument == "--symbol" && i + 1 < argc)
+        {
+            names.push_back(argv[++i]);
+        }
+        else if (argument.starts_with("--"))
+        {
+            std::fprintf(stderr,
+                         "usage: %s [--repeat N] [--size BYTES] [--symbol NAME]... [FILE...]\n",
+                         argv[0]);
+            return 2;
+        }
+        else
+        {
+            files.push_back(argument);
+        }
+    }
+    if (names.empty())
+    {
+        names = {"throw_statement", "goto_statement", "lambda_expression"};
+    }
+
+    ts::language language{tree_sitter_cpp()};
+    std::vector<ts::symbol> symbols;
+    for (std::string_view name : names)
+    {
+        ts::symbol symbol = language.get_symbol_for_name(name, true);
+        if (symbol == 0)
+        {
+            std::fprintf(stderr, "unknown symbol: %.*s\n", static_cast<int>(name.size()), name.data());
+            return 2;
+        }
+        symbols.push_back(symbol);
+    }
+
+    if (files.empty())
+    {
+        run("generated", bench::generate_cpp(size), symbols, std::max(1u, repeat));
+    }
+    for (std::string_view file : files)
+    {
+        std::optional<std::string> source = tools::read_file(std::string{file});
+        if (!source)
+        {
+            std::fprintf(stderr, "cannot read %.*s\n", static_cast<int>(file.size()), file.data());
+            return 1;
+        }
+        run(file, *source, symbols, std::max(1u, repeat));
+    }
+    return 0;
+}